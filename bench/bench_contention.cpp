@@ -0,0 +1,101 @@
+#include "game.h"
+#include "constants.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+// Конкуренция редактора с запущенной игрой: несколько потоков без остановки
+// вызывают add_npc, пока идут тики движения и бои. Печатает пропускную
+// способность и задержки add_npc и сколько тиков игра успела за это время.
+//
+// bench_contention [потоков_добавления] [NPC_на_старте] [секунд] [пауза_между_добавлениями_мкс]
+// Без потоков добавления (0) печатается базовая частота тиков.
+
+namespace {
+
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int ch) override { return ch; }
+    std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+double percentile(std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1));
+    return sorted[index];
+}
+
+}
+
+int main(int argc, char** argv) {
+    size_t writers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4;
+    int initial = argc > 2 ? std::atoi(argv[2]) : 2000;
+    double seconds = argc > 3 ? std::atof(argv[3]) : 3.0;
+    int pause_us = argc > 4 ? std::atoi(argv[4]) : 0;
+
+    // Игра пишет в cout на каждое добавление и каждый бой
+    NullBuffer null_buffer;
+    std::streambuf* original = std::cout.rdbuf(&null_buffer);
+
+    Game game;
+    game.initialize_game(initial);
+    game.start();
+
+    std::atomic<bool> running{true};
+    std::vector<std::vector<double>> latencies(writers);
+    std::vector<std::thread> threads;
+
+    auto started = std::chrono::steady_clock::now();
+    uint64_t ticks_before = game.get_tick_count();
+
+    for (size_t w = 0; w < writers; ++w) {
+        threads.emplace_back([&, w]() {
+            std::mt19937 gen(static_cast<unsigned>(1000 + w));
+            std::uniform_int_distribution<int> coord(0, MAP_WIDTH - 1);
+            std::uniform_int_distribution<int> type(0, static_cast<int>(NPC_TYPE_COUNT) - 1);
+            while (running) {
+                auto begin = std::chrono::steady_clock::now();
+                game.add_npc(static_cast<NpcType>(type(gen)), "Editor", coord(gen), coord(gen));
+                std::chrono::duration<double, std::micro> took = std::chrono::steady_clock::now() - begin;
+                latencies[w].push_back(took.count());
+                if (pause_us > 0) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(pause_us));
+                }
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    running = false;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+    uint64_t ticks = game.get_tick_count() - ticks_before;
+    game.stop();
+    std::cout.rdbuf(original);
+
+    std::vector<double> all;
+    for (auto& local : latencies) {
+        all.insert(all.end(), local.begin(), local.end());
+    }
+    std::sort(all.begin(), all.end());
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "writers: " << writers << ", initial NPCs: " << initial
+              << ", window: " << elapsed.count() << " s\n";
+    std::cout << "NPCs at end    : " << game.get_alive_count() << " alive\n";
+    std::cout << "add_npc        : " << all.size() / elapsed.count() << " calls/s\n";
+    std::cout << "add_npc latency: p50 " << percentile(all, 0.50) << " us, p99 "
+              << percentile(all, 0.99) << " us, max " << (all.empty() ? 0.0 : all.back()) << " us\n";
+    std::cout << "movement ticks : " << ticks << " (" << ticks / elapsed.count() << " per second)\n";
+    return 0;
+}
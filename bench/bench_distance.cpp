@@ -0,0 +1,79 @@
+#include "distance_kernel.h"
+#include <bitset>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+
+// Пропускная способность проверки дальности: пар в секунду
+// для старого пути (sqrt(pow) на double) и пакетного ядра
+
+namespace {
+
+const size_t NPC_COUNT = 4096;
+const int RANGE = 30;
+const int ROUNDS = 20;
+
+template <class Body>
+double pairs_per_second(Body&& body, uint64_t& checksum) {
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < ROUNDS; ++round) {
+        checksum += body();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(NPC_COUNT) * NPC_COUNT * ROUNDS / elapsed.count();
+}
+
+}
+
+int main() {
+    std::mt19937 gen(12345);
+    std::uniform_int_distribution<int> coord(0, EDITOR_MAX_X - 1);
+
+    std::vector<Position> points;
+    PositionBlock block;
+    for (size_t i = 0; i < NPC_COUNT; ++i) {
+        Position p{coord(gen), coord(gen)};
+        points.push_back(p);
+        block.push_back(p);
+    }
+
+    uint64_t checksum = 0;
+
+    double baseline = pairs_per_second([&]() {
+        uint64_t hits = 0;
+        for (const auto& a : points) {
+            for (const auto& b : points) {
+                hits += a.distance_to(b) <= RANGE;
+            }
+        }
+        return hits;
+    }, checksum);
+
+    double scalar = pairs_per_second([&]() {
+        uint64_t hits = 0;
+        for (const auto& a : points) {
+            for (size_t base = 0; base < NPC_COUNT; base += RANGE_BLOCK_SIZE) {
+                hits += std::bitset<64>(range_hit_mask_scalar(
+                    a, block.xs.data() + base, block.ys.data() + base, RANGE_BLOCK_SIZE, RANGE)).count();
+            }
+        }
+        return hits;
+    }, checksum);
+
+    double dispatched = pairs_per_second([&]() {
+        uint64_t hits = 0;
+        for (const auto& a : points) {
+            for_each_in_range(a, block, RANGE, [&](size_t) { ++hits; });
+        }
+        return hits;
+    }, checksum);
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "NPCs: " << NPC_COUNT << ", range: " << RANGE << ", checksum: " << checksum << "\n";
+    std::cout << "sqrt(pow) double : " << baseline / 1e6 << " Mpairs/s\n";
+    std::cout << "scalar squared   : " << scalar / 1e6 << " Mpairs/s\n";
+    std::cout << (distance_kernel_uses_avx2() ? "avx2  " : "scalar") << " dispatched: "
+              << dispatched / 1e6 << " Mpairs/s\n";
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "factory.h"
+#include "species.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Несколько потоков создают NPC через одну фабрику: основы видов вперемешку,
+// каждое восьмое имя задано явно с номером ("Frog123"), как при загрузке и
+// вводе редактора. Режим "global mutex" - как раньше, когда Game держал один
+// замок на всё создание. После замера все имена проверяются на уникальность.
+//
+// bench_factory [созданий_на_поток] [наибольшее_число_потоков]
+
+namespace {
+
+const int EXPLICIT_EVERY = 8;
+
+struct RunResult {
+    double milliseconds = 0;
+    size_t created = 0;
+    size_t duplicates = 0;
+};
+
+RunResult run(size_t per_thread, size_t thread_count, bool global_mutex) {
+    GameConfig world{0, 999, 0, 999};
+    NpcFactory factory(world);
+    std::mutex serial;
+    std::vector<std::vector<std::shared_ptr<BaseNpc>>> made(thread_count);
+    size_t species_count = SpeciesRegistry::instance().size();
+
+    auto produce = [&](size_t thread) {
+        auto& out = made[thread];
+        out.reserve(per_thread);
+        std::string explicit_name;
+        for (size_t i = 0; i < per_thread; ++i) {
+            NpcType type = static_cast<NpcType>((thread + i) % species_count);
+            std::string_view base = species(type).display_name;
+            std::string_view name = base;
+            if (i % EXPLICIT_EVERY == 0) {
+                explicit_name.assign(base);
+                explicit_name += std::to_string(thread * per_thread + i + 1);
+                name = explicit_name;
+            }
+            int x = static_cast<int>(i % 1000);
+            int y = static_cast<int>((i / 1000 + thread) % 1000);
+            if (global_mutex) {
+                std::lock_guard<std::mutex> lock(serial);
+                out.push_back(factory.create_npc(type, name, x, y));
+            } else {
+                out.push_back(factory.create_npc(type, name, x, y));
+            }
+        }
+    };
+
+    auto started = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; ++t) {
+        threads.emplace_back(produce, t);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - started;
+
+    RunResult result;
+    result.milliseconds = elapsed.count();
+    std::unordered_set<uint64_t> names;
+    for (const auto& list : made) {
+        for (const auto& npc : list) {
+            ++result.created;
+            if (!names.insert(npc->get_name_id().key()).second) {
+                ++result.duplicates;
+            }
+        }
+    }
+    return result;
+}
+
+}
+
+int main(int argc, char** argv) {
+    size_t per_thread = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    size_t max_threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 8;
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << per_thread << " creations per thread, " << std::thread::hardware_concurrency()
+              << " hardware threads\n";
+    std::cout << std::left << std::setw(14) << "mode" << std::right << std::setw(8) << "threads"
+              << std::setw(12) << "ms" << std::setw(16) << "creations/s" << std::setw(12) << "duplicates" << "\n";
+
+    bool failed = false;
+    for (bool global_mutex : {true, false}) {
+        for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+            RunResult r = run(per_thread, threads, global_mutex);
+            std::cout << std::left << std::setw(14) << (global_mutex ? "global mutex" : "sharded") << std::right
+                      << std::setw(8) << threads << std::setw(12) << r.milliseconds
+                      << std::setw(16) << r.created / (r.milliseconds / 1000.0)
+                      << std::setw(12) << r.duplicates << "\n";
+            failed = failed || r.duplicates != 0;
+        }
+    }
+    return failed ? 1 : 0;
+}
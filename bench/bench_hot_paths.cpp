@@ -0,0 +1,201 @@
+#include "battle.h"
+#include "factory.h"
+#include "game.h"
+#include "world_shards.h"
+#include "parallel.h"
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Горячие пути симуляции на 1e2..1e6 NPC. Мир строится generate_world с
+// постоянным seed и стороной под постоянную плотность (AREA_PER_NPC клеток на
+// NPC), поэтому прогоны на разных машинах и коммитах сравнимы. Вывод игры
+// (бои, убийства) на время замера отключается.
+//
+// balagur_fate_bench [--benchmark_filter=...] [--benchmark_out=result.json --benchmark_out_format=json]
+
+namespace {
+
+const uint32_t WORLD_SEED = 2025;
+const int AREA_PER_NPC = 400;
+const int FIGHT_RANGE = 10;
+const int64_t MIN_COUNT = 100;
+const int64_t MAX_COUNT = 1000000;
+const char* const SAVE_FILE = "bench_hot_paths_npcs.txt";
+
+// Пока жив, всё, что печатает игра в std::cout, пропадает
+class MutedOutput {
+private:
+    std::streambuf* saved;
+
+public:
+    MutedOutput() : saved(std::cout.rdbuf(nullptr)) {}
+    ~MutedOutput() {
+        std::cout.rdbuf(saved);
+        std::cout.clear();
+    }
+    MutedOutput(const MutedOutput&) = delete;
+    MutedOutput& operator=(const MutedOutput&) = delete;
+};
+
+GameConfig world_for(size_t count) {
+    int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(count) * AREA_PER_NPC)));
+    return {0, side - 1, 0, side - 1};
+}
+
+std::vector<std::shared_ptr<BaseNpc>> make_world(NpcFactory& factory, size_t count) {
+    GameConfig world = world_for(count);
+    factory.set_config(world);
+    return factory.generate_world(count, world, WORLD_SEED, 1);
+}
+
+// Тот же путь, что Game::check_collisions при сетке: снимок, раскладка по
+// регионам, столкновения по kill_distance каждого вида
+void BM_CheckCollisions(benchmark::State& state) {
+    size_t count = static_cast<size_t>(state.range(0));
+    NpcFactory factory;
+    SlotMap<std::shared_ptr<BaseNpc>> npcs;
+    for (auto& npc : make_world(factory, count)) {
+        npcs.insert(std::move(npc));
+    }
+    Battle battle;
+    WorldShards shards;
+    CombatView view;
+    std::vector<std::shared_ptr<BaseNpc>> snapshot;
+    std::vector<uint32_t> slot_ids;
+    std::vector<CombatPair> pairs;
+    size_t threads = std::min(default_thread_count(), count / MIN_NPCS_PER_THREAD + 1);
+
+    for (auto _ : state) {
+        snapshot.assign(npcs.begin(), npcs.end());
+        slot_ids.resize(npcs.size());
+        for (size_t i = 0; i < npcs.size(); ++i) {
+            slot_ids[i] = npcs.handle_at(i).index();
+        }
+        view.assign(snapshot.begin(), snapshot.end());
+        shards.assign(view, slot_ids);
+        shards.find_collisions(battle, view, pairs, threads);
+        benchmark::DoNotOptimize(pairs.data());
+    }
+    state.counters["pairs"] = static_cast<double>(pairs.size());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+
+// Бой убивает, поэтому мир пересоздаётся перед каждым проходом вне замера
+void BM_GameFight(benchmark::State& state) {
+    size_t count = static_cast<size_t>(state.range(0));
+    MutedOutput muted;
+    Game game(world_for(count));
+    game.set_log_rotation(LOG_ROTATE_BYTES, 1);   // журнал убийств не растёт от прогона к прогону
+    for (auto _ : state) {
+        state.PauseTiming();
+        game.initialize_game(static_cast<int>(count), WORLD_SEED);
+        state.ResumeTiming();
+        game.fight(FIGHT_RANGE);
+    }
+    state.counters["alive"] = game.get_alive_count();
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+
+void BM_BattleFight(benchmark::State& state) {
+    size_t count = static_cast<size_t>(state.range(0));
+    NpcFactory factory;
+    Battle battle;
+    std::vector<std::shared_ptr<INpc>> npcs;
+    for (auto _ : state) {
+        state.PauseTiming();
+        factory.clear_names();
+        auto world = make_world(factory, count);
+        npcs.assign(world.begin(), world.end());
+        world.clear();
+        state.ResumeTiming();
+        battle.fight(npcs, FIGHT_RANGE);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+
+// Один шаг каждого NPC; блуждание остаётся в границах мира
+void BM_NpcMove(benchmark::State& state) {
+    size_t count = static_cast<size_t>(state.range(0));
+    NpcFactory factory;
+    auto npcs = make_world(factory, count);
+    GameConfig world = world_for(count);
+    for (auto _ : state) {
+        for (auto& npc : npcs) {
+            npc->move(world);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+
+// count имён одной основы в пустом реестре; каждое восьмое - явное с номером
+void BM_GenerateUniqueName(benchmark::State& state) {
+    size_t count = static_cast<size_t>(state.range(0));
+    std::vector<std::string> explicit_names;
+    for (size_t i = 0; i < count; i += 8) {
+        explicit_names.push_back("Frog" + std::to_string(i + 1));
+    }
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto names = std::make_unique<NameGenerator>();
+        state.ResumeTiming();
+        for (size_t i = 0; i < count; ++i) {
+            NameId name = i % 8 == 0 ? names->generate_unique_name(explicit_names[i / 8])
+                                     : names->generate_unique_name("Frog");
+            benchmark::DoNotOptimize(name);
+        }
+        state.PauseTiming();
+        names.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+
+void BM_FactorySave(benchmark::State& state) {
+    size_t count = static_cast<size_t>(state.range(0));
+    NpcFactory factory;
+    auto npcs = make_world(factory, count);
+    for (auto _ : state) {
+        factory.save_to_file(SAVE_FILE, npcs);
+    }
+    std::remove(SAVE_FILE);
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+
+void BM_FactoryLoad(benchmark::State& state) {
+    size_t count = static_cast<size_t>(state.range(0));
+    NpcFactory factory;
+    factory.save_to_file(SAVE_FILE, make_world(factory, count));
+    for (auto _ : state) {
+        state.PauseTiming();
+        factory.clear_names();
+        state.ResumeTiming();
+        auto loaded = factory.load_from_file(SAVE_FILE);
+        benchmark::DoNotOptimize(loaded.data());
+        state.PauseTiming();
+        loaded.clear();
+        state.ResumeTiming();
+    }
+    std::remove(SAVE_FILE);
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+
+void npc_counts(benchmark::internal::Benchmark* bench) {
+    bench->RangeMultiplier(10)->Range(MIN_COUNT, MAX_COUNT)->Unit(benchmark::kMillisecond);
+}
+
+}
+
+BENCHMARK(BM_CheckCollisions)->Apply(npc_counts);
+BENCHMARK(BM_GameFight)->Apply(npc_counts);
+BENCHMARK(BM_BattleFight)->Apply(npc_counts);
+BENCHMARK(BM_NpcMove)->Apply(npc_counts);
+BENCHMARK(BM_GenerateUniqueName)->Apply(npc_counts);
+BENCHMARK(BM_FactorySave)->Apply(npc_counts);
+BENCHMARK(BM_FactoryLoad)->Apply(npc_counts);
+
+BENCHMARK_MAIN();
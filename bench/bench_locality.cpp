@@ -0,0 +1,182 @@
+#include "battle.h"
+#include "factory.h"
+#include "morton.h"
+#include "slot_map.h"
+#include "species.h"
+#include "world_shards.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Хранилище NPC в порядке создания против того же хранилища, пересортированного
+// по коду Мортона. Один проход повторяет тик игры в одном потоке: снимок,
+// раскладка по регионам, движение, поиск столкновений. Промахи кэша берутся
+// из счётчиков процессора (perf_event_open), если ядро их даёт.
+//
+// bench_locality [число_NPC] [сторона_мира] [проходов]
+
+namespace {
+
+class MissCounter {
+private:
+    int fd = -1;
+
+public:
+    MissCounter() {
+#if defined(__linux__)
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+    ~MissCounter() {
+#if defined(__linux__)
+        if (fd >= 0) close(fd);
+#endif
+    }
+    bool available() const { return fd >= 0; }
+
+    void start() {
+#if defined(__linux__)
+        if (fd < 0) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+    uint64_t stop() {
+        uint64_t count = 0;
+#if defined(__linux__)
+        if (fd < 0) return 0;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) != static_cast<ssize_t>(sizeof(count))) count = 0;
+#endif
+        return count;
+    }
+};
+
+struct PassResult {
+    double milliseconds = 0;
+    uint64_t misses = 0;
+    size_t pairs = 0;
+};
+
+PassResult run_passes(SlotMap<std::shared_ptr<BaseNpc>>& npcs, const GameConfig& world, int passes,
+                      MissCounter& counter) {
+    Battle battle;
+    WorldShards shards;
+    CombatView view;
+    std::vector<std::shared_ptr<BaseNpc>> snapshot;
+    std::vector<uint32_t> slot_ids;
+    std::vector<CombatPair> pairs;
+    PassResult result;
+
+    counter.start();
+    auto started = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; ++pass) {
+        snapshot.assign(npcs.begin(), npcs.end());
+        slot_ids.resize(npcs.size());
+        for (size_t i = 0; i < npcs.size(); ++i) {
+            slot_ids[i] = npcs.handle_at(i).index();
+        }
+        view.assign(snapshot.begin(), snapshot.end());
+        shards.assign(view, slot_ids);
+
+        shards.for_each_region(1, [&](size_t region) {
+            const uint32_t* members = shards.owned(region);
+            for (size_t k = 0; k < shards.owned_count(region); ++k) {
+                snapshot[members[k]]->move(world);
+            }
+        });
+
+        view.assign(snapshot.begin(), snapshot.end());
+        shards.find_collisions(battle, view, pairs, 1);
+        result.pairs += pairs.size();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - started;
+    result.misses = counter.stop();
+    result.milliseconds = elapsed.count() / passes;
+    result.misses /= static_cast<uint64_t>(passes);
+    return result;
+}
+
+double disorder_of(const SlotMap<std::shared_ptr<BaseNpc>>& npcs) {
+    PositionBlock positions;
+    for (const auto& npc : npcs) {
+        positions.push_back(npc->get_position());
+    }
+    return morton_disorder(positions, MORTON_CELL_SIZE);
+}
+
+void print_result(const char* label, const PassResult& r, double disorder, bool with_misses) {
+    std::cout << std::left << std::setw(16) << label << std::right
+              << std::setw(10) << disorder << std::setw(12) << r.milliseconds;
+    if (with_misses) {
+        std::cout << std::setw(16) << r.misses;
+    } else {
+        std::cout << std::setw(16) << "n/a";
+    }
+    std::cout << std::setw(12) << r.pairs << "\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    int side = argc > 2 ? std::atoi(argv[2]) : 2000;
+    int passes = argc > 3 ? std::atoi(argv[3]) : 5;
+
+    GameConfig world{0, side - 1, 0, side - 1};
+    NpcFactory factory(world);
+    SlotMap<std::shared_ptr<BaseNpc>> npcs;
+    npcs.reserve(count);
+
+    std::mt19937 gen(2025);
+    std::uniform_int_distribution<int> coord(0, side - 1);
+    std::uniform_int_distribution<int> type(0, static_cast<int>(SpeciesRegistry::instance().size()) - 1);
+    for (size_t i = 0; i < count; ++i) {
+        NpcType t = static_cast<NpcType>(type(gen));
+        npcs.insert(factory.create_npc(t, species(t).display_name, coord(gen), coord(gen)));
+    }
+
+    MissCounter counter;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << count << " NPCs, world " << side << "x" << side << ", " << passes << " passes\n";
+    if (!counter.available()) {
+        std::cout << "hardware cache-miss counter unavailable (perf_event_paranoid or no PMU)\n";
+    }
+    std::cout << std::left << std::setw(16) << "storage order" << std::right << std::setw(10) << "disorder"
+              << std::setw(12) << "ms/pass" << std::setw(16) << "misses/pass" << std::setw(12) << "pairs" << "\n";
+
+    double before_disorder = disorder_of(npcs);
+    PassResult before = run_passes(npcs, world, passes, counter);
+    print_result("creation", before, before_disorder, counter.available());
+
+    PositionBlock positions;
+    for (const auto& npc : npcs) {
+        positions.push_back(npc->get_position());
+    }
+    npcs.reorder(morton_order(positions));
+
+    double after_disorder = disorder_of(npcs);
+    PassResult after = run_passes(npcs, world, passes, counter);
+    print_result("morton", after, after_disorder, counter.available());
+    std::cout << "disorder after the passes: " << disorder_of(npcs) << "\n";
+    return 0;
+}
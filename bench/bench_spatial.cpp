@@ -0,0 +1,196 @@
+#include "spatial_index.h"
+#include "constants.h"
+#include "density_grid.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+
+// Сетка против квадродерева на картах редактора 500x500 разной скученности.
+// Для каждой формы печатает время построения, запросов по радиусу (как в
+// check_collisions и fight), запросов окна карты и одного тика движения:
+// сетка перестраивается целиком, дерево переносит точки по одной.
+// Строка density - сетка плотности: число NPC в окне вместо списка.
+//
+// bench_spatial [число_NPC] [радиус]
+
+namespace {
+
+const int MAP_SIZE = EDITOR_MAX_X;
+const int VIEWPORT = 100;
+const int VIEWPORT_QUERIES = 200;
+const int MOVE_STEP = 2;
+
+struct Shape {
+    std::string name;
+    std::function<Position(std::mt19937&)> sample;
+};
+
+int clamp_to_map(double value) {
+    return std::max(0, std::min(MAP_SIZE - 1, static_cast<int>(std::lround(value))));
+}
+
+std::vector<Shape> make_shapes() {
+    std::vector<Shape> shapes;
+    shapes.push_back({"uniform", [](std::mt19937& gen) {
+        std::uniform_int_distribution<int> coord(0, MAP_SIZE - 1);
+        return Position{coord(gen), coord(gen)};
+    }});
+    shapes.push_back({"8 clusters", [](std::mt19937& gen) {
+        static const Position centers[8] = {{60, 60}, {440, 80}, {250, 250}, {90, 400},
+                                            {400, 420}, {160, 200}, {330, 140}, {260, 460}};
+        std::uniform_int_distribution<int> pick(0, 7);
+        std::normal_distribution<double> spread(0.0, 6.0);
+        const Position& c = centers[pick(gen)];
+        return Position{clamp_to_map(c.x + spread(gen)), clamp_to_map(c.y + spread(gen))};
+    }});
+    shapes.push_back({"one hot spot", [](std::mt19937& gen) {
+        std::normal_distribution<double> spread(0.0, 3.0);
+        return Position{clamp_to_map(250 + spread(gen)), clamp_to_map(250 + spread(gen))};
+    }});
+    shapes.push_back({"ring", [](std::mt19937& gen) {
+        std::uniform_real_distribution<double> angle(0.0, 6.283185307179586);
+        std::normal_distribution<double> spread(0.0, 2.0);
+        double a = angle(gen);
+        return Position{clamp_to_map(250 + 180 * std::cos(a) + spread(gen)),
+                        clamp_to_map(250 + 180 * std::sin(a) + spread(gen))};
+    }});
+    return shapes;
+}
+
+template <class Body>
+double milliseconds(Body&& body) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+struct Timings {
+    double build = 0;
+    double radius = 0;
+    double viewport = 0;
+    double tick = 0;
+    size_t hits = 0;
+};
+
+void print_row(const std::string& shape, const std::string& index, const Timings& t, size_t extra) {
+    std::cout << std::left << std::setw(14) << shape << std::setw(10) << index << std::right
+              << std::setw(10) << t.build << std::setw(12) << t.radius
+              << std::setw(12) << t.viewport << std::setw(10) << t.tick
+              << std::setw(12) << t.hits << std::setw(10) << extra << "\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    int range = argc > 2 ? std::atoi(argv[2]) : 10;
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << count << " NPCs on " << MAP_SIZE << "x" << MAP_SIZE << ", radius " << range
+              << ", " << VIEWPORT << "x" << VIEWPORT << " viewport, times in ms\n";
+    std::cout << std::left << std::setw(14) << "shape" << std::setw(10) << "index" << std::right
+              << std::setw(10) << "build" << std::setw(12) << "radius" << std::setw(12) << "viewport"
+              << std::setw(10) << "tick" << std::setw(12) << "hits" << std::setw(10) << "cells" << "\n";
+
+    for (const auto& shape : make_shapes()) {
+        std::mt19937 gen(2025);
+        PositionBlock positions;
+        positions.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            positions.push_back(shape.sample(gen));
+        }
+
+        std::vector<Position> viewports;
+        std::uniform_int_distribution<int> corner(0, MAP_SIZE - VIEWPORT);
+        for (int q = 0; q < VIEWPORT_QUERIES; ++q) {
+            viewports.push_back({corner(gen), corner(gen)});
+        }
+
+        // Один и тот же шаг движения для обоих индексов
+        PositionBlock moved = positions;
+        std::uniform_int_distribution<int> step(-MOVE_STEP, MOVE_STEP);
+        for (size_t i = 0; i < count; ++i) {
+            moved.xs[i] = std::max(0, std::min(MAP_SIZE - 1, moved.xs[i] + step(gen)));
+            moved.ys[i] = std::max(0, std::min(MAP_SIZE - 1, moved.ys[i] + step(gen)));
+        }
+
+        auto measure = [&](ISpatialIndex& index, const std::function<void()>& tick) {
+            Timings t;
+            std::vector<uint32_t> out;
+            t.build = milliseconds([&]() { index.build(positions); });
+            t.radius = milliseconds([&]() {
+                for (size_t i = 0; i < count; ++i) {
+                    out.clear();
+                    index.query_radius({positions.xs[i], positions.ys[i]}, range, out);
+                    t.hits += out.size();
+                }
+            });
+            t.viewport = milliseconds([&]() {
+                for (const auto& v : viewports) {
+                    out.clear();
+                    index.query_rect(v.x, v.y, v.x + VIEWPORT - 1, v.y + VIEWPORT - 1, out);
+                    t.hits += out.size();
+                }
+            });
+            t.tick = milliseconds(tick);
+            return t;
+        };
+
+        SpatialGrid grid(std::max(range, 1));
+        Timings grid_time = measure(grid, [&]() { grid.build(moved); });
+        print_row(shape.name, "grid", grid_time, grid.cell_count());
+
+        QuadTree tree;
+        Timings tree_time = measure(tree, [&]() {
+            for (size_t i = 0; i < count; ++i) {
+                tree.update(static_cast<uint32_t>(i), {moved.xs[i], moved.ys[i]});
+            }
+        });
+        print_row(shape.name, "quadtree", tree_time, tree.leaf_count());
+
+        // Наведение: каждый NPC ищет ближайшего соседа, как хищник добычу за тик
+        std::vector<Neighbour> found;
+        size_t seek_hits = 0;
+        double seek = milliseconds([&]() {
+            for (size_t i = 0; i < count; ++i) {
+                tree.nearest({moved.xs[i], moved.ys[i]}, 2, found);
+                seek_hits += found.size();
+            }
+        });
+        std::cout << std::left << std::setw(14) << shape.name << std::setw(10) << "nearest" << std::right
+                  << std::setw(10) << "" << std::setw(12) << seek << std::setw(12) << "" << std::setw(10) << ""
+                  << std::setw(12) << seek_hits << "\n";
+
+        // Плотность: те же окна - четыре чтения на вид, тик - только сменившие клетку
+        DensityGrid density;
+        Timings counted;
+        counted.build = milliseconds([&]() {
+            density.reset({0, MAP_SIZE - 1, 0, MAP_SIZE - 1}, 1);
+            for (size_t i = 0; i < count; ++i) {
+                density.update(static_cast<uint32_t>(i), NpcType{}, {positions.xs[i], positions.ys[i]});
+            }
+            density.build_sums();
+        });
+        counted.viewport = milliseconds([&]() {
+            for (const auto& v : viewports) {
+                counted.hits += density.count(NpcType{}, v.x, v.y, v.x + VIEWPORT - 1, v.y + VIEWPORT - 1);
+            }
+        });
+        counted.tick = milliseconds([&]() {
+            for (size_t i = 0; i < count; ++i) {
+                density.update(static_cast<uint32_t>(i), NpcType{}, {moved.xs[i], moved.ys[i]});
+            }
+            density.build_sums();
+        });
+        print_row(shape.name, "density", counted, static_cast<size_t>(density.get_columns()) * density.get_rows());
+    }
+    return 0;
+}
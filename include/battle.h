@@ -1,21 +1,179 @@
 #pragma once
 
 #include "npc.h"
+#include "npc_types.h"
 #include "visitor.h"
 #include "observer.h"
+#include "distance_kernel.h"
+#include "spatial_index.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
 #include <vector>
 #include <memory>
 #include <mutex>
 
+// Снимок хранилища NPC для боевого движка: координаты, виды и флаги жизни
+// подряд в памяти. Индекс в снимке совпадает с индексом в исходном хранилище.
+struct CombatView {
+    PositionBlock positions;
+    std::vector<NpcType> types;
+    std::vector<uint8_t> alive;
+
+    void clear() {
+        positions.clear();
+        types.clear();
+        alive.clear();
+    }
+    void reserve(size_t count) {
+        positions.reserve(count);
+        types.reserve(count);
+        alive.reserve(count);
+    }
+    // Пустой указатель попадает в снимок мёртвым, чтобы индексы не съезжали
+    template <class NpcPtr>
+    void push_back(const NpcPtr& npc) {
+        positions.push_back(npc ? npc->get_position() : Position{0, 0});
+        types.push_back(npc ? npc->get_type() : NpcType{});
+        alive.push_back(npc && npc->is_alive());
+    }
+    // Копирует запись i другого снимка
+    void append(const CombatView& source, size_t i) {
+        positions.push_back(source.position(i));
+        types.push_back(source.types[i]);
+        alive.push_back(source.alive[i]);
+    }
+    template <class It>
+    void assign(It first, It last) {
+        clear();
+        reserve(static_cast<size_t>(std::distance(first, last)));
+        for (; first != last; ++first) {
+            push_back(*first);
+        }
+    }
+    Position position(size_t i) const { return {positions.xs[i], positions.ys[i]}; }
+    size_t size() const { return types.size(); }
+};
+
+struct CombatPair {
+    uint32_t attacker;
+    uint32_t defender;
+};
+
+// Бой реального времени: кубики бросаются, только если оба живы и атакующий
+// может убить защитника
+struct Duel {
+    BaseNpc* attacker = nullptr;
+    BaseNpc* defender = nullptr;
+    int attack = 0;
+    int defense = 0;
+    bool fought = false;
+    bool killed = false;
+    bool lost_claim = false;    // бросок выигран, но жертву раньше забрал другой убийца
+};
+
 class Battle {
 private:
     std::vector<std::shared_ptr<IObserver>> observers;
     mutable std::mutex mutex;
+    std::shared_ptr<const IExecutionPolicy> policy;
+
+    template <class RangeOf>
+    void collect_pairs(const CombatView& view, const ISpatialIndex& index, size_t attacker_count,
+                       RangeOf&& range_of, std::vector<CombatPair>& out,
+                       const IExecutionPolicy& run_policy) const;
 
 public:
+    Battle();
+
     void add_observer(std::shared_ptr<IObserver> observer);
     void remove_observer(std::shared_ptr<IObserver> observer);
     void clear_observers();
-    void fight(std::vector<std::shared_ptr<INpc>>& npcs, int range);
     void notify_observers(const std::shared_ptr<INpc>& killer, const std::shared_ptr<INpc>& victim);
-};
\ No newline at end of file
+
+    void set_policy(std::shared_ptr<const IExecutionPolicy> new_policy);
+    const IExecutionPolicy& get_policy() const { return *policy; }
+
+    // Пары (атакующий, жертва) в пределах range; индекс построен по view.positions.
+    // При упорядоченной политике пары идут по атакующему, затем по жертве.
+    void find_fights(const CombatView& view, const ISpatialIndex& index, int range,
+                     std::vector<CombatPair>& out) const;
+    void find_fights(const CombatView& view, const ISpatialIndex& index, int range,
+                     std::vector<CombatPair>& out, const IExecutionPolicy& run_policy) const;
+    // То же, но дистанция берётся из kill_distance вида атакующего
+    void find_collisions(const CombatView& view, const ISpatialIndex& index,
+                         std::vector<CombatPair>& out) const;
+    // Атакуют только первые attacker_count записей снимка, остальные
+    // (призраки соседних регионов) бывают лишь жертвами
+    void find_collisions(const CombatView& view, const ISpatialIndex& index, size_t attacker_count,
+                         std::vector<CombatPair>& out, const IExecutionPolicy& run_policy) const;
+
+    // Все пары найдены по одному снимку, поэтому жертва гибнет, даже если её
+    // убийца погиб раньше в этом же пакете. Пары делятся по жертвам на
+    // независимые группы, и группы разбираются параллельно: claim(attacker,
+    // defender) пробует убить жертву первой пары группы (CAS на флаге жизни,
+    // так что параллельный resolve_duels её не перехватит). Затем
+    // report(attacker, defender) вызывается в вызывающем потоке ровно один раз
+    // на каждую смерть, в порядке пар. Возвращает число смертей.
+    template <class Claim, class Report>
+    size_t apply_kills(const std::vector<CombatPair>& pairs, CombatView& view,
+                       Claim&& claim, Report&& report, const IExecutionPolicy& run_policy) const;
+    template <class Claim, class Report>
+    size_t apply_kills(const std::vector<CombatPair>& pairs, CombatView& view,
+                       Claim&& claim, Report&& report) const {
+        return apply_kills(pairs, view, claim, report, *policy);
+    }
+
+    // Дуэли разыгрываются по порядку: исход каждой зависит от предыдущих
+    void resolve_duels(std::vector<Duel>& duels) const;
+
+    void fight(std::vector<std::shared_ptr<INpc>>& npcs, int range);
+};
+
+template <class Claim, class Report>
+size_t Battle::apply_kills(const std::vector<CombatPair>& pairs, CombatView& view,
+                           Claim&& claim, Report&& report, const IExecutionPolicy& run_policy) const {
+    // Устойчивая сортировка подсчётом по жертве: внутри группы пары идут в
+    // исходном порядке, и побеждает первая, как при разборе в один поток
+    size_t total = view.size();
+    std::vector<uint32_t> group_start(total + 1, 0);
+    for (const auto& pair : pairs) {
+        ++group_start[pair.defender + 1];
+    }
+    for (size_t i = 0; i < total; ++i) {
+        group_start[i + 1] += group_start[i];
+    }
+    std::vector<uint32_t> by_defender(pairs.size());
+    {
+        std::vector<uint32_t> cursor(group_start.begin(), group_start.end() - 1);
+        for (size_t p = 0; p < pairs.size(); ++p) {
+            by_defender[cursor[pairs[p].defender]++] = static_cast<uint32_t>(p);
+        }
+    }
+
+    // Каждая жертва принадлежит ровно одному куску, поэтому view.alive
+    // пишется без гонок
+    std::vector<std::vector<uint32_t>> chunk_deaths(run_policy.chunk_count(total));
+    run_policy.run(total, [&](size_t chunk, size_t begin, size_t end) {
+        auto& local_deaths = chunk_deaths[chunk];
+        for (size_t defender = begin; defender < end; ++defender) {
+            if (group_start[defender] == group_start[defender + 1] || !view.alive[defender]) continue;
+            uint32_t winner = by_defender[group_start[defender]];
+            view.alive[defender] = 0;
+            if (claim(pairs[winner].attacker, pairs[winner].defender)) {
+                local_deaths.push_back(winner);
+            }
+        }
+    });
+
+    std::vector<uint32_t> deaths;
+    for (auto& local_deaths : chunk_deaths) {
+        deaths.insert(deaths.end(), local_deaths.begin(), local_deaths.end());
+    }
+    std::sort(deaths.begin(), deaths.end());
+    for (uint32_t p : deaths) {
+        report(pairs[p].attacker, pairs[p].defender);
+    }
+    return deaths.size();
+}
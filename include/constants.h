@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+
 const int MAP_WIDTH = 100;
 const int MAP_HEIGHT = 100;
 const int EDITOR_MAX_X = 500;
@@ -7,12 +10,49 @@ const int EDITOR_MAX_Y = 500;
 const int GAME_DURATION_SECONDS = 30;
 const int INITIAL_NPC_COUNT = 50;
 const int DICE_SIDES = 6;
+const int MIN_NPCS_PER_THREAD = 256;
+const int REGION_SIZE = 64;
+const int WORLD_BLOCK_SIZE = 4096;   // generate_world: NPC на один генератор случайных чисел
+const int MAP_VIEW_SIZE = 100;       // print_map выводит не больше стольких символов по стороне
+const int LIVE_MAP_FPS = 10;
+const int DENSITY_GRID_MAX_SIDE = 512;   // сторона сетки плотности карты не больше стольких клеток
+const int MORTON_CELL_SIZE = 64;     // беспорядок хранилища считается по клеткам такого размера
+const int REORDER_INTERVAL_TICKS = 20;     // пересортировка хранилища раз в столько тиков (0 - только по беспорядку)
+const double REORDER_DISORDER_THRESHOLD = 0.45;   // или раньше, если беспорядок выше (0.5 - случайный порядок)
+const int RESPAWN_BATCH_LIMIT = 4096;      // поддержание населения: не больше стольких NPC за один проход
+const int TICK_RATE_SAMPLE_MS = 1000;      // тики в секунду считаются по таким промежуткам
+const int TICK_RATE_HISTORY = 3600;        // и хранятся для стольких последних промежутков
+const uintmax_t LOG_ROTATE_BYTES = 1 << 20;   // долгий прогон: журнал боёв ротируется по такому размеру
+const int LOG_ROTATE_FILES = 3;
+const char* const SPECIES_CONFIG_FILE = "species.txt";
+
+// Границы мира (включительно). Задаются во время выполнения; константы выше -
+// только значения по умолчанию.
+struct GameConfig {
+    int min_x = 0;
+    int max_x = EDITOR_MAX_X;
+    int min_y = 0;
+    int max_y = EDITOR_MAX_Y;
+
+    int64_t width() const { return static_cast<int64_t>(max_x) - min_x + 1; }
+    int64_t height() const { return static_cast<int64_t>(max_y) - min_y + 1; }
+    bool contains(int x, int y) const { return x >= min_x && x <= max_x && y >= min_y && y <= max_y; }
+    int clamp_x(int x) const { return std::max(min_x, std::min(x, max_x)); }
+    int clamp_y(int y) const { return std::max(min_y, std::min(y, max_y)); }
+    bool operator==(const GameConfig& other) const {
+        return min_x == other.min_x && max_x == other.max_x && min_y == other.min_y && max_y == other.max_y;
+    }
+    bool operator!=(const GameConfig& other) const { return !(*this == other); }
+};
+
+const GameConfig EDITOR_BOUNDS = {0, EDITOR_MAX_X, 0, EDITOR_MAX_Y};
+const GameConfig WORLD_BOUNDS = {0, MAP_WIDTH - 1, 0, MAP_HEIGHT - 1};
 
 struct MovementConfig {
     int move_distance;
     int kill_distance;
 };
 
-const MovementConfig BULL_CONFIG = {30, 10};
-const MovementConfig FROG_CONFIG = {1, 10};
-const MovementConfig DRAGON_CONFIG = {50, 30};
\ No newline at end of file
+constexpr MovementConfig BULL_CONFIG = {30, 10};
+constexpr MovementConfig FROG_CONFIG = {1, 10};
+constexpr MovementConfig DRAGON_CONFIG = {50, 30};
\ No newline at end of file
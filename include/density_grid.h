@@ -0,0 +1,77 @@
+#pragma once
+
+#include "constants.h"
+#include "kill_rules.h"
+#include "npc.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Число NPC каждого вида по клеткам cell_size x cell_size и таблица
+// префиксных сумм по ним: количество в прямоугольнике - четыре чтения на вид,
+// сколько бы NPC ни было. Размер клетки подбирается так, чтобы сторона сетки
+// не превышала max_side; прямоугольник считается по клеткам, которых касается.
+//
+// NPC хранятся по номеру (как в TypedIndex): update меняет счётчики, только
+// если NPC сменил клетку или вид, а build_sums пересчитывает суммы вида лишь
+// от первой изменившейся строки.
+class DensityGrid {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+    static constexpr uint32_t OUTSIDE = UINT32_MAX - 1;   // учтён в итоге, но не в клетках
+
+private:
+    GameConfig bounds;
+    int cell_size = 1;
+    int columns = 0;
+    int rows = 0;
+    size_t type_count = 0;
+    std::vector<uint32_t> counts;   // [вид][строка][колонка]
+    std::vector<uint32_t> sums;     // [вид][строка + 1][колонка + 1], нулевые строка и колонка
+    std::vector<uint32_t> cell_of;  // [номер] -> клетка, OUTSIDE или NONE
+    std::vector<uint16_t> type_of;
+    std::vector<int> dirty_row;     // [вид] -> первая строка с устаревшими суммами
+    size_t total = 0;               // все учтённые, в том числе вне границ
+
+    size_t stride() const { return static_cast<size_t>(columns) + 1; }
+    size_t plane() const { return stride() * (static_cast<size_t>(rows) + 1); }
+    uint32_t cell_at(const Position& pos) const;
+    void change(size_t type, uint32_t cell, int delta);
+
+public:
+    // Новые границы и число видов; все счётчики и номера сбрасываются
+    void reset(const GameConfig& world, size_t types, int max_side = DENSITY_GRID_MAX_SIDE);
+    // Убирает все номера, не меняя размеров
+    void clear();
+    // Добавляет номер или переносит его в клетку pos
+    void update(uint32_t id, NpcType type, const Position& pos);
+    void erase(uint32_t id);
+    bool contains(uint32_t id) const { return id < cell_of.size() && cell_of[id] != NONE; }
+    // Все номера меньше этого; для обхода contains
+    size_t id_capacity() const { return cell_of.size(); }
+    // Пересчитывает префиксные суммы после update/erase
+    void build_sums();
+
+    // NPC вида type в клетках, которых касается прямоугольник (включительно)
+    uint32_t count(NpcType type, int min_x, int min_y, int max_x, int max_y) const {
+        size_t t = static_cast<size_t>(type);
+        if (t >= type_count) return 0;
+        int c0, r0, c1, r1;
+        if (!cell_range(min_x, min_y, max_x, max_y, c0, r0, c1, r1)) return 0;
+        const uint32_t* s = sums.data() + t * plane();
+        size_t w = stride();
+        return s[(r1 + 1) * w + (c1 + 1)] - s[r0 * w + (c1 + 1)] - s[(r1 + 1) * w + c0] + s[r0 * w + c0];
+    }
+    uint64_t count(const TypeMask& types, int min_x, int min_y, int max_x, int max_y) const;
+
+    // Клетки сетки, которых касается прямоугольник; false, если он вне границ
+    bool cell_range(int min_x, int min_y, int max_x, int max_y, int& c0, int& r0, int& c1, int& r1) const;
+
+    const GameConfig& get_bounds() const { return bounds; }
+    int get_cell_size() const { return cell_size; }
+    int get_columns() const { return columns; }
+    int get_rows() const { return rows; }
+    size_t get_type_count() const { return type_count; }
+    size_t get_total() const { return total; }
+    bool empty() const { return columns == 0; }
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "npc.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Координаты NPC подряд в памяти (структура массивов) для пакетных проверок
+struct PositionBlock {
+    std::vector<int32_t> xs;
+    std::vector<int32_t> ys;
+
+    void clear() {
+        xs.clear();
+        ys.clear();
+    }
+    void reserve(size_t count) {
+        xs.reserve(count);
+        ys.reserve(count);
+    }
+    void push_back(const Position& pos) {
+        xs.push_back(pos.x);
+        ys.push_back(pos.y);
+    }
+    size_t size() const { return xs.size(); }
+};
+
+const size_t RANGE_BLOCK_SIZE = 64;
+
+// Бит i результата выставлен, если кандидат i лежит не дальше range от center.
+// Сравниваются квадраты расстояний в 64-битных целых, без sqrt и округлений;
+// точно для любых int32-координат, range больше INT32_MAX - 1 считается им.
+// count <= RANGE_BLOCK_SIZE. Путь AVX2 выбирается при запуске, если процессор его умеет.
+uint64_t range_hit_mask(const Position& center, const int32_t* xs, const int32_t* ys, size_t count, int range);
+uint64_t range_hit_mask_scalar(const Position& center, const int32_t* xs, const int32_t* ys, size_t count, int range);
+bool distance_kernel_uses_avx2();
+
+inline int lowest_bit_index(uint64_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+// Вызывает visit(index) для каждого кандидата из block в пределах range
+template <class Visit>
+void for_each_in_range(const Position& center, const PositionBlock& block, int range, Visit&& visit) {
+    size_t total = block.size();
+    for (size_t base = 0; base < total; base += RANGE_BLOCK_SIZE) {
+        size_t count = total - base < RANGE_BLOCK_SIZE ? total - base : RANGE_BLOCK_SIZE;
+        uint64_t mask = range_hit_mask(center, block.xs.data() + base, block.ys.data() + base, count, range);
+        while (mask) {
+            visit(base + static_cast<size_t>(lowest_bit_index(mask)));
+            mask &= mask - 1;
+        }
+    }
+}
@@ -1,48 +1,130 @@
 #pragma once
 #include "npc_types.h"
+#include "npc_pool.h"
+#include <array>
+#include <atomic>
 #include <memory>
 #include <fstream>
+#include <mutex>
+#include <shared_mutex>
 #include <vector>
-#include <set>
-
-struct GameConfig {
-    int min_x = 0;
-    int max_x = EDITOR_MAX_X;
-    int min_y = 0;
-    int max_y = EDITOR_MAX_Y;
-};
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 
+// Реестр занятых имён для нескольких потоков создания.
+//  - Занятые имена лежат в SHARDS частях по хэшу имени, у каждой свой замок:
+//    разные номера одной основы почти всегда попадают в разные части.
+//  - Номера для основы без цифр на конце поток берёт у общего атомарного
+//    счётчика основы блоками по ORDINAL_BLOCK и раздаёт сам; блок потока
+//    помнит и то, что имя без номера уже занято.
+//  - Счётчики основ лежат в BASE_SHARDS частях по номеру основы под
+//    shared_mutex: к ним обращаются раз в блок и на явных именах с номером.
+//  - Освобождённые номера (release) блок берёт раньше новых, поэтому при
+//    постоянном населении номера не растут.
+// clear() нельзя вызывать одновременно с выдачей имён.
 class NameGenerator {
+public:
+    static constexpr size_t SHARDS = 64;
+    static constexpr size_t BASE_SHARDS = 16;
+    static constexpr uint32_t ORDINAL_BLOCK = 64;
+
 private:
-    std::set<std::string> used_names;
+    struct NameShard {
+        std::mutex mutex;
+        std::unordered_set<uint64_t> used;
+    };
+    struct BaseState {
+        std::atomic<uint32_t> next_ordinal{1};
+        std::atomic<uint32_t> highest{0};                      // наибольший явно занятый номер
+        std::vector<std::pair<uint32_t, uint32_t>> reserved;  // [first, last], под замком части
+        std::mutex free_mutex;
+        std::vector<uint32_t> free_ordinals;
+    };
+    struct BaseShard {
+        std::shared_mutex mutex;
+        std::unordered_map<uint32_t, std::unique_ptr<BaseState>> states;
+    };
+
+    std::array<NameShard, SHARDS> names;
+    std::array<BaseShard, BASE_SHARDS> bases;
+    std::atomic<uint64_t> generation;   // уникален среди генераторов; меняется в clear()
+
+    NameShard& shard_of(uint64_t key) { return names[((key * 0x9E3779B97F4A7C15ull) >> 58) % SHARDS]; }
+    bool insert(const NameId& name);
+    BaseState& state_of(uint32_t base);
+    // Имя, заданное явно: не из резерва и ещё не занято
+    bool try_take(const NameId& name);
+
 public:
-    std::string generate_unique_name(const std::string& base_name) {
-        std::string name = base_name;
-        int counter = 1;
-        while (used_names.find(name) != used_names.end()) {
-            name = base_name + std::to_string(counter++);
-        }
-        used_names.insert(name);
-        return name;
-    }
-    void clear() { used_names.clear(); }
+    NameGenerator();
+
+    NameId generate_unique_name(std::string_view base_name);
+    // Номера first..first+count-1 основы base_name (без цифр на конце) отдаются
+    // вызывающему целиком: по одному они не проверяются и больше не выдаются
+    NameId reserve_names(std::string_view base_name, uint32_t count);
+    // Имя снова свободно; вызывать один раз и только для имени, которого больше
+    // ни у кого нет
+    void release(const NameId& name);
+    void clear();
+
+    NameGenerator(const NameGenerator&) = delete;
+    NameGenerator& operator=(const NameGenerator&) = delete;
 };
 
+// Фабрика для нескольких потоков создания без внешних замков. Пул вида
+// разбит на POOL_STRIPES полос, поток берёт полосу по своему номеру.
+// set_config, clear_names и release_pools - только без параллельного создания.
 class NpcFactory {
+public:
+    static constexpr size_t POOL_STRIPES = 8;
+    static constexpr size_t MAX_TYPES = 256;
+
 private:
     NameGenerator name_generator;
     GameConfig config;
+    std::vector<std::shared_ptr<NpcPool>> pools;   // [вид * POOL_STRIPES + полоса]; размер не меняется
+    std::unique_ptr<std::atomic<bool>[]> pool_ready;
+    std::vector<std::shared_ptr<NpcPool>> worker_pools;   // generate_world: по пулу на поток
+    mutable std::mutex pools_mutex;   // создание пулов и worker_pools
+
+    const std::shared_ptr<NpcPool>& pool_for(NpcType type);
+
+    template <class T, class... Args>
+    static std::shared_ptr<BaseNpc> make_in(const std::shared_ptr<NpcPool>& pool, Args&&... args) {
+        PoolAllocator<T> allocator(pool);
+        return std::allocate_shared<T>(allocator, std::forward<Args>(args)...);
+    }
+
+    template <class T, class... Args>
+    std::shared_ptr<BaseNpc> make_pooled(NpcType type, Args&&... args) {
+        return make_in<T>(pool_for(type), std::forward<Args>(args)...);
+    }
     
 public:
-    NpcFactory() = default;
-    NpcFactory(const GameConfig& config) : config(config) {}
+    NpcFactory();
+    NpcFactory(const GameConfig& config);
     
     void set_config(const GameConfig& new_config) { config = new_config; }
     GameConfig get_config() const { return config; }
     void clear_names() { name_generator.clear(); }
+    void release_name(const NameId& name) { name_generator.release(name); }
+
+    // Счётчики пулов по всем типам и массовое освобождение (после reset_game).
+    // Пулы потоков generate_world входят только в общий счёт.
+    PoolStats get_pool_stats() const;
+    PoolStats get_pool_stats(NpcType type) const;
+    void release_pools();
     
-    std::shared_ptr<INpc> create_npc(NpcType type, const std::string& base_name, int x, int y);
-    std::shared_ptr<INpc> create_npc_from_stream(std::istream& in);
-    std::vector<std::shared_ptr<INpc>> load_from_file(const std::string& filename);
+    std::shared_ptr<BaseNpc> create_npc(NpcType type, std::string_view base_name, int x, int y);
+    std::shared_ptr<BaseNpc> create_npc_from_stream(std::istream& in);
+    // Мир из count NPC со случайными видами и координатами в bounds. Каждый
+    // блок из WORLD_BLOCK_SIZE NPC получает свой генератор от (seed, номер блока),
+    // поэтому мир зависит от seed, но не от числа потоков. Имена - основа вида и
+    // номер из зарезервированного диапазона, без проверки по множеству имён.
+    std::vector<std::shared_ptr<BaseNpc>> generate_world(size_t count, const GameConfig& bounds, uint32_t seed,
+                                                         size_t thread_count);
+    std::vector<std::shared_ptr<BaseNpc>> load_from_file(const std::string& filename);
     void save_to_file(const std::string& filename, const std::vector<std::shared_ptr<INpc>>& npcs);
+    void save_to_file(const std::string& filename, const std::vector<std::shared_ptr<BaseNpc>>& npcs);
 };
\ No newline at end of file
@@ -1,65 +1,294 @@
 #pragma once
 
 #include "npc.h"
+#include "npc_types.h"
 #include "factory.h"
 #include "observer.h"
+#include "slot_map.h"
+#include "battle.h"
+#include "world_shards.h"
+#include "typed_index.h"
+#include "map_renderer.h"
+#include "density_grid.h"
+#include "npc_graveyard.h"
 #include <vector>
 #include <memory>
 #include <thread>
 #include <mutex>
 #include <shared_mutex>
 #include <queue>
+#include <deque>
+#include <random>
 #include <atomic>
 #include <chrono>
 
+// RANDOM - случайный шаг; SEEK_PREY - хищники идут к ближайшей добыче
+enum class MovementMode {
+    RANDOM,
+    SEEK_PREY
+};
+
+// TYPES - символ преобладающего вида; DENSITY - цифра d: от 2^(d-1) NPC
+enum class MapLayer {
+    TYPES,
+    DENSITY
+};
+
+// Описание NPC для add_npcs
+struct NpcSpec {
+    NpcType type;
+    std::string base_name;
+    int x;
+    int y;
+};
+
+// Итог add_npcs. handles идут в порядке описаний; у отвергнутых - пустой дескриптор.
+struct AddNpcsSummary {
+    size_t requested = 0;
+    size_t added = 0;
+    size_t out_of_bounds = 0;   // вне границ фабрики: редактора, после initialize_game - мира
+    size_t unknown_type = 0;    // вида нет в реестре
+    size_t failed = 0;          // фабрика бросила исключение при создании
+    std::vector<NpcHandle> handles;
+};
+
+// Тики движения в секунду за промежуток, закончившийся через seconds после start()
+struct TickRateSample {
+    double seconds = 0;
+    double ticks_per_second = 0;
+    size_t alive = 0;
+};
+
 struct BattleTask {
-    std::shared_ptr<INpc> attacker;
-    std::shared_ptr<INpc> defender;
+    NpcHandle attacker;
+    NpcHandle defender;
 };
 
+// Копия хранилища на момент снимка. NPC держит метка pin: cleanup_dead_npcs
+// может убирать их из хранилища, пока снимок обрабатывается, но освобождены
+// они будут только после clear() или уничтожения снимка.
+struct NpcSnapshot {
+    std::vector<BaseNpc*> npcs;
+    std::vector<NpcHandle> handles;
+    NpcPin pin;
+
+    void clear() {
+        npcs.clear();
+        handles.clear();
+        pin.reset();
+    }
+    size_t size() const { return npcs.size(); }
+};
+
+// Замки:
+//  - npcs_mutex охраняет только структуру хранилища (вставка, удаление,
+//    снимок) и держится недолго: без вывода, движения и боёв;
+//  - координаты NPC замком не охраняются: Position - atomic, и его двигает
+//    только поток региона, которому NPC принадлежит в этом тике. Читатель
+//    (fight, save_to_file, карта) видит каждую позицию целиком, но позиции
+//    разных NPC могут быть из соседних тиков;
+//  - index_mutex охраняет world_index; поток движения при наведении держит
+//    его разделяемо, пока регионы двигают NPC;
+//  - density_mutex охраняет сетку плотности карты, viewport_mutex - окно
+//    карты; под ними других замков не берут;
+//  - factory_mutex создающие держат разделяемо, сброс фабрики - исключительно;
+//    под ним других замков не берут;
+//  - метки graveyard берутся до npcs_mutex, похороны - после него.
+// Других вложений нет.
 class Game {
 private:
-    std::vector<std::shared_ptr<INpc>> npcs;
+    SlotMap<std::shared_ptr<BaseNpc>> npcs;
     mutable std::shared_mutex npcs_mutex;
+    // Убранные из npcs ждут здесь, пока их могут видеть снимки и бои
+    mutable NpcGraveyard graveyard;
+    GameConfig world_bounds;     // меняется только при остановленной игре
+    GameConfig editor_bounds;
     
     std::queue<BattleTask> battle_queue;
     std::mutex battle_queue_mutex;
     
     NpcFactory factory;
+    std::shared_mutex factory_mutex;   // фабрика сама безопасна для создающих потоков
+    Battle battle;
+    WorldShards shards;   // только поток движения
+    SpatialIndexKind index_kind = SpatialIndexKind::GRID;   // меняется только при остановленной игре
+    std::atomic<MovementMode> movement_mode{MovementMode::RANDOM};
+    // Деревья по видам с ключом - номером слота; обновляются по месту из
+    // снимка (refresh_index). Отвечают на nearest/query_radius, наводят
+    // хищников и ищут столкновения при index_kind == QUADTREE.
+    TypedIndex world_index;
+    std::vector<uint32_t> indexed_slots;
+    std::vector<NpcHandle> handle_of_slot;
+    mutable std::shared_mutex index_mutex;
+    std::atomic<bool> index_stale{true};   // хранилище или координаты менялись после refresh_index
+    std::atomic<bool> map_wants_index{false};   // окно карты мельче клетки сетки плотности
+    // Сетка плотности по видам: обновляется по месту потоком движения раз
+    // в тик, вне игры - при запросе, если хранилище менялось
+    DensityGrid density;
+    mutable std::shared_mutex density_mutex;
+    std::atomic<bool> density_stale{true};
     std::shared_ptr<ConsoleObserver> console_observer;
     std::shared_ptr<FileObserver> file_observer;
     
     std::chrono::steady_clock::time_point game_start_time;
     std::atomic<bool> game_running{false};
+    std::atomic<uint64_t> tick_count{0};
+    uint32_t reorder_interval = REORDER_INTERVAL_TICKS;       // меняются только при остановленной игре
+    double reorder_threshold = REORDER_DISORDER_THRESHOLD;
+    std::atomic<uint64_t> reorder_count{0};
+    
+    // Поддержание населения: после уборки мёртвых поток боёв добавляет
+    // недостающих до цели; имена убранных освобождаются для новых
+    std::vector<size_t> population_target;   // [вид]; пустой - выключено
+    mutable std::mutex population_mutex;
+    std::atomic<bool> respawn_enabled{false};
+    std::atomic<uint64_t> respawn_count{0};
+    std::mt19937 respawn_rng;                // дальше - только поток боёв
+    std::vector<NameId> freed_names;
+    std::vector<size_t> alive_by_type;
+    std::deque<TickRateSample> tick_rate_history;   // не больше TICK_RATE_HISTORY
+    mutable std::mutex tick_rate_mutex;
     
     std::thread movement_thread;
     std::thread battle_thread;
     
+    // Живая карта: свой поток рисует кадры из снимков с постоянной частотой
+    std::thread render_thread;
+    std::atomic<bool> live_map_running{false};
+    std::atomic<uint64_t> frames_rendered{0};
+    std::atomic<uint64_t> frames_dropped{0};
+    FrameWriter frame_writer;
+    GameConfig map_viewport;
+    bool viewport_set = false;   // иначе окно - весь мир
+    mutable std::mutex viewport_mutex;
+    std::atomic<MapLayer> map_layer{MapLayer::TYPES};
+    
     mutable std::mutex cout_mutex;
     
     void movement_worker();
+    void movement_tick(const NpcSnapshot& snapshot, CombatView& view, std::vector<uint32_t>& dense_of_slot,
+                       uint32_t& ticks_since_reorder);
     void battle_worker();
-    void check_collisions();
-    void cleanup_dead_npcs();
+    // Ищет пары по снимку и регионам тика; dense_of_slot - от refresh_index этого тика
+    void check_collisions(const NpcSnapshot& snapshot, const CombatView& view,
+                          const std::vector<uint32_t>& dense_of_slot, size_t threads);
+    void take_snapshot(NpcSnapshot& snapshot) const;
+    void assign_regions(const NpcSnapshot& snapshot, CombatView& view);
+    void refresh_index(const NpcSnapshot& snapshot, const CombatView& view, std::vector<uint32_t>& dense_of_slot);
+    void ensure_index();
+    void refresh_density(const NpcSnapshot& snapshot);
+    void ensure_density();
+    // С respawn - ещё и имена убранных в freed_names и живые по видам в alive_by_type
+    void cleanup_dead_npcs(bool respawn = false);
+    void respawn_population();
+    void record_tick_rate(std::chrono::steady_clock::time_point& last_sample, uint64_t& last_ticks);
+    void compose_map_frame(FrameBuffer& frame);
+    void count_visible_npcs(const GameConfig& view, int64_t scale, int view_width, size_t types,
+                            std::vector<uint64_t>& totals, std::vector<uint16_t>& dominant);
+    void render_worker(int fps);
+    void notify_kill(const BaseNpc& killer, NpcHandle killer_handle, const BaseNpc& victim, NpcHandle victim_handle);
     
 public:
-    Game();
+    explicit Game(const GameConfig& world_bounds = WORLD_BOUNDS, const GameConfig& editor_bounds = EDITOR_BOUNDS);
     ~Game();
-    void add_npc(NpcType type, const std::string& base_name, int x, int y);
+    NpcHandle add_npc(NpcType type, const std::string& base_name, int x, int y);
+    // Пакетное добавление: проверка всех описаний до создания, одна вставка
+    // под npcs_mutex и итог вместо строки на каждого NPC. Неверные описания
+    // и отказы фабрики пропускаются и считаются в итоге; остальные вставляются.
+    AddNpcsSummary add_npcs(const NpcSpec* specs, size_t count);
+    AddNpcsSummary add_npcs(const std::vector<NpcSpec>& specs) { return add_npcs(specs.data(), specs.size()); }
     void load_from_file(const std::string& filename);
     void save_to_file(const std::string& filename);
     void print_npcs();
     void fight(int range);
+    // thread_count == 0 - как 1: бой в вызывающем потоке
+    void fight(int range, size_t thread_count);
 
     void initialize_game(int npc_count);
+    // Тот же мир при том же seed и границах мира, при любом числе потоков
+    void initialize_game(int npc_count, uint32_t seed);
     void reset_game();  
     void start();
     void stop();
     
+    // Карта окна собирается в буфер по сетке плотности и выводится одной
+    // записью; стоимость зависит от размера экрана, а не от числа NPC
     void print_map();
+    // Окно карты (включительно), обрезанное по границам мира
+    void set_map_viewport(const GameConfig& viewport);
+    void reset_map_viewport();
+    GameConfig get_map_viewport() const;
+    void set_map_layer(MapLayer layer) { map_layer = layer; }
+    MapLayer get_map_layer() const { return map_layer.load(); }
+    // Перерисовка карты fps раз в секунду: только изменившиеся клетки
+    void start_live_map(int fps = LIVE_MAP_FPS);
+    void stop_live_map();
+    bool is_live_map_running() const { return live_map_running.load(); }
+    uint64_t get_frames_rendered() const { return frames_rendered.load(); }
+    // Кадры, пропущенные из-за того, что отрисовка не успела к сроку
+    uint64_t get_frames_dropped() const { return frames_dropped.load(); }
+    // Куда отправляется текст кадра; пустой - в терминал (write_to_terminal)
+    void set_frame_writer(FrameWriter writer);
     void print_survivors();
     int get_alive_count() const;
     int get_game_time() const;
+
+    // Границы мира для initialize_game и движения; только при остановленной игре
+    void set_world_bounds(const GameConfig& bounds);
+    const GameConfig& get_world_bounds() const { return world_bounds; }
+    const GameConfig& get_editor_bounds() const { return editor_bounds; }
+    // Индекс для fight и check_collisions; квадродерево выгоднее на сильно
+    // скученных картах. Только при остановленной игре.
+    void set_spatial_index(SpatialIndexKind kind);
+    SpatialIndexKind get_spatial_index() const { return index_kind; }
+    void set_movement_mode(MovementMode mode) { movement_mode = mode; }
+    MovementMode get_movement_mode() const { return movement_mode.load(); }
+
+    // Хранилище пересортировывается по коду Мортона раз в interval_ticks тиков
+    // (0 - не по счётчику) или когда беспорядок превышает disorder_threshold
+    // (больше 1 - никогда). Только при остановленной игре.
+    void set_storage_reorder(uint32_t interval_ticks, double disorder_threshold);
+    // Пересортировка сейчас; false, если хранилище поменялось во время расчёта
+    bool reorder_storage();
+    double get_storage_disorder() const;
+    uint64_t get_reorder_count() const { return reorder_count.load(); }
+
+    // До k ближайших к pos живых NPC видов из types, по возрастанию расстояния.
+    // Во время игры - по координатам на границе последнего тика.
+    std::vector<NpcHandle> nearest(const Position& pos, const TypeMask& types, size_t k);
+    // Живые NPC видов из types не дальше range от pos
+    std::vector<NpcHandle> query_radius(const Position& pos, int range, const TypeMask& types);
+    // Живые NPC видов из types в клетках сетки плотности, которых касается rect:
+    // по запросу к префиксным суммам на вид, без обхода NPC. Во время игры -
+    // на границе последнего тика. Точно, если get_density_cell_size() == 1.
+    uint64_t count_in_rect(const GameConfig& rect, const TypeMask& types);
+    uint64_t count_in_rect(const GameConfig& rect, NpcType type);
+    int get_density_cell_size();
+    // Число завершённых тиков движения с последнего start()
+    uint64_t get_tick_count() const { return tick_count.load(); }
+    // Тики в секунду по промежуткам TICK_RATE_SAMPLE_MS с последнего start(),
+    // последние TICK_RATE_HISTORY
+    std::vector<TickRateSample> get_tick_rate_history() const;
+
+    // Постоянное население для долгих прогонов: во время игры после каждой
+    // уборки мёртвых появляются недостающие до target[вид] NPC в случайных
+    // точках мира (не больше RESPAWN_BATCH_LIMIT за раз). Они занимают
+    // освобождённые слоты, места в пулах и имена, поэтому память не растёт.
+    // Пустой target выключает.
+    void set_population_target(const std::vector<size_t>& target);
+    std::vector<size_t> get_population_target() const;
+    uint64_t get_respawn_count() const { return respawn_count.load(); }
+    // Задержки фаз тика (p50/p99/max) с прошлого вывода; счётчики сбрасываются.
+    // Пишутся, только если сборка с ENABLE_PHASE_PROFILER.
+    void print_phase_profile();
+    // Ротация журнала боёв; max_bytes == 0 - без ротации
+    void set_log_rotation(uintmax_t max_bytes, size_t keep_files) { file_observer->set_rotation(max_bytes, keep_files); }
+
+    // Запросы по дескрипторам; устаревший дескриптор даёт false/nullptr.
+    // contains() - только для живых: убитый до уборки NPC уже не считается.
+    bool contains(NpcHandle handle) const;
+    std::shared_ptr<INpc> get_npc(NpcHandle handle) const;
+    std::vector<NpcHandle> get_handles() const;
     
     Game(const Game&) = delete;
     Game& operator=(const Game&) = delete;
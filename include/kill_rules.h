@@ -0,0 +1,35 @@
+#pragma once
+
+#include "npc.h"
+#include <array>
+#include <bitset>
+#include <cstdint>
+
+// Виды задаются данными, поэтому жертвы вида - битовое множество на MAX_SPECIES бит.
+// Проверка "может ли A убить B" стоит один тест бита при любом числе видов.
+const size_t MAX_SPECIES = 256;
+using TypeMask = std::bitset<MAX_SPECIES>;
+
+inline TypeMask type_mask(NpcType type) {
+    return TypeMask().set(static_cast<size_t>(type));
+}
+
+// Встроенные правила (строка - атакующий, бит - жертва); с них начинается реестр видов
+constexpr uint32_t builtin_bit(NpcType type) {
+    return uint32_t(1) << static_cast<unsigned>(type);
+}
+
+constexpr std::array<uint32_t, NPC_TYPE_COUNT> BUILTIN_KILL_MATRIX = {{
+    builtin_bit(NpcType::BULL),   // Дракон убивает только быков
+    0,                            // Лягушка никого не убивает
+    builtin_bit(NpcType::FROG),   // Бык убивает лягушек
+}};
+
+constexpr bool builtin_can_kill(NpcType attacker, NpcType victim) {
+    return (BUILTIN_KILL_MATRIX[static_cast<size_t>(attacker)] & builtin_bit(victim)) != 0;
+}
+
+static_assert(builtin_can_kill(NpcType::DRAGON, NpcType::BULL), "");
+static_assert(!builtin_can_kill(NpcType::DRAGON, NpcType::FROG), "");
+static_assert(builtin_can_kill(NpcType::BULL, NpcType::FROG), "");
+static_assert(BUILTIN_KILL_MATRIX[static_cast<size_t>(NpcType::FROG)] == 0, "");
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Кадр карты: прямоугольник символов, строки подряд в одном буфере
+class FrameBuffer {
+private:
+    int width = 0;
+    int height = 0;
+    std::string cells;
+
+public:
+    FrameBuffer() = default;
+    FrameBuffer(int width, int height) { resize(width, height); }
+
+    // Новый размер; все клетки становятся пробелами
+    void resize(int new_width, int new_height);
+    void fill(char value) { cells.assign(cells.size(), value); }
+
+    char& at(int x, int y) { return cells[static_cast<size_t>(y) * width + x]; }
+    char at(int x, int y) const { return cells[static_cast<size_t>(y) * width + x]; }
+    // Текст с колонки column; не влезающее в строку отрезается
+    void put_text(int row, int column, std::string_view text);
+
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+    const std::string& data() const { return cells; }
+    std::string_view row(int y) const { return std::string_view(cells).substr(static_cast<size_t>(y) * width, width); }
+};
+
+// Вывод кадра одной строкой, которую пишущий отправляет одним вызовом write.
+// Первый кадр и каждый full_redraw_frames-й рисуются целиком (чужой вывод
+// мог сдвинуть экран); остальные - только изменившиеся клетки с адресацией курсора.
+class MapRenderer {
+private:
+    FrameBuffer previous;
+    bool has_previous = false;
+    size_t full_redraw_frames;
+    size_t frames_since_full = 0;
+    size_t changed_cells = 0;
+
+public:
+    explicit MapRenderer(size_t full_redraw_frames = 100) : full_redraw_frames(full_redraw_frames) {}
+
+    std::string next(const FrameBuffer& frame);
+    // Следующий кадр будет нарисован целиком
+    void reset() { has_previous = false; }
+    // Клеток, отправленных последним кадром
+    size_t last_changed_cells() const { return changed_cells; }
+
+    // Кадр для обычного прокручиваемого вывода: строки через '\n'
+    static std::string plain(const FrameBuffer& frame);
+    // Очистка экрана и кадр целиком
+    static std::string full(const FrameBuffer& frame);
+    // Только изменившиеся клетки: ESC[строка;колонкаH и новые символы
+    static std::string diff(const FrameBuffer& before, const FrameBuffer& after, size_t* changed = nullptr);
+};
+
+using FrameWriter = std::function<void(const std::string&)>;
+
+// Пишет текст в стандартный вывод одним системным вызовом (повторяя при
+// частичной записи); буферы cout и stdout перед этим сбрасываются
+void write_to_terminal(const std::string& text);
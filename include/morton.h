@@ -0,0 +1,28 @@
+#pragma once
+
+#include "distance_kernel.h"
+#include <cstdint>
+#include <vector>
+
+// Код Мортона (Z-порядок): биты x и y чередуются, поэтому точки, близкие
+// на карте, в основном получают близкие коды.
+inline uint64_t morton_code(uint32_t x, uint32_t y) {
+    auto spread = [](uint64_t v) {
+        v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+        v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+        v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+        v = (v | (v << 2)) & 0x3333333333333333ull;
+        v = (v | (v << 1)) & 0x5555555555555555ull;
+        return v;
+    };
+    return spread(x) | (spread(y) << 1);
+}
+
+// Перестановка точек по коду Мортона (от минимальных координат блока):
+// order[k] - индекс точки, встающей на место k. Равные коды сохраняют порядок.
+std::vector<uint32_t> morton_order(const PositionBlock& positions);
+
+// Доля соседних записей, у которых клетка cell_size x cell_size идёт в
+// Z-порядке раньше клетки предыдущей записи: 0 у отсортированного
+// хранилища, около 0.5 у хранилища в случайном порядке.
+double morton_disorder(const PositionBlock& positions, int cell_size);
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Имя NPC: интернированная основа + порядковый номер (0 - без суффикса).
+// "Frog123" хранится как {id("Frog"), 123} и собирается в строку только при выводе.
+struct NameId {
+    uint32_t base = 0;
+    uint32_t ordinal = 0;
+
+    uint64_t key() const { return (static_cast<uint64_t>(base) << 32) | ordinal; }
+    bool operator==(const NameId& other) const { return base == other.base && ordinal == other.ordinal; }
+    bool operator!=(const NameId& other) const { return !(*this == other); }
+};
+
+class NameTable {
+private:
+    std::deque<std::string> strings;
+    std::unordered_map<std::string_view, uint32_t> index;
+    mutable std::shared_mutex mutex;
+
+    static constexpr size_t THREAD_CACHE_LIMIT = 4096;
+
+    NameTable();
+    uint32_t intern_shared(std::string_view str);
+
+public:
+    static NameTable& instance();
+
+    uint32_t intern(std::string_view str);
+    std::string_view view(uint32_t id) const;
+    size_t size() const;
+
+    NameId make_name(std::string_view full_name);
+    std::string format(const NameId& name) const;
+
+    NameTable(const NameTable&) = delete;
+    NameTable& operator=(const NameTable&) = delete;
+};
+
+std::ostream& operator<<(std::ostream& os, const NameId& name);
@@ -1,16 +1,44 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <cmath>
 #include <random>
 #include <sstream>
 #include "constants.h"
+#include "name_table.h"
 
 class IVisitor;
 class IObserver;
 
-enum class NpcType { DRAGON, FROG, BULL };
+// Встроенные виды; остальные номера задаются реестром видов (species.h)
+enum class NpcType : uint8_t { DRAGON, FROG, BULL };
+const int NPC_TYPE_COUNT = 3;
+
+constexpr size_t type_index(NpcType type) { return static_cast<size_t>(type); }
+
+// Компактный генератор xorshift32: 4 байта состояния вместо 2.5 КБ у mt19937
+class NpcRng {
+private:
+    uint32_t state;
+public:
+    using result_type = uint32_t;
+
+    explicit NpcRng(uint32_t seed_value = 0x9E3779B9u) { seed(seed_value); }
+    void seed(uint32_t seed_value) { state = seed_value ? seed_value : 0x9E3779B9u; }
+
+    static constexpr result_type min() { return 1; }
+    static constexpr result_type max() { return UINT32_MAX; }
+
+    result_type operator()() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+};
 
 struct Position {
     int x, y;
@@ -22,17 +50,19 @@ struct Position {
     void random_move(int max_distance) {
         static std::random_device rd;
         static std::mt19937 gen(rd());
-        std::uniform_int_distribution<int> dist(-max_distance, max_distance);
-        x += dist(gen);
-        y += dist(gen);
+        random_move(max_distance, gen);
     }
 
-    bool is_within_editor_bounds() const {
-        return x >= 0 && x < EDITOR_MAX_X && y >= 0 && y < EDITOR_MAX_Y;
+    template <class Rng>
+    void random_move(int max_distance, Rng& rng) {
+        std::uniform_int_distribution<int> dist(-max_distance, max_distance);
+        x += dist(rng);
+        y += dist(rng);
     }
 
-    bool is_within_game_bounds() const {
-        return x >= 0 && x < MAP_WIDTH && y >= 0 && y < MAP_HEIGHT;
+    // Границы - из GameConfig игры или редактора: размер мира задаётся при запуске
+    bool is_within(const GameConfig& bounds) const {
+        return bounds.contains(x, y);
     }
 
     std::string to_string() const {
@@ -45,13 +75,18 @@ public:
     virtual ~INpc() = default;
     virtual Position get_position() const = 0;
     virtual std::string get_name() const = 0;
+    virtual NameId get_name_id() const = 0;
     virtual NpcType get_type() const = 0;
-    virtual std::string get_type_str() const = 0;
+    virtual std::string_view get_type_str() const = 0;
     virtual std::string info() const = 0;
+    virtual void print_info(std::ostream& os) const = 0;
     virtual bool is_alive() const = 0;
     virtual void kill() = 0;
+    // true только у того, кто перевёл NPC из живых в мёртвые
+    virtual bool try_kill() = 0;
     virtual bool accept(const std::shared_ptr<IVisitor>& visitor) = 0;
-    virtual void move() = 0;
+    // Случайный шаг; bounds - границы мира той игры, где живёт NPC
+    virtual void move(const GameConfig& bounds) = 0;
     virtual MovementConfig get_movement_config() const = 0;
     virtual int roll_dice() const = 0;
     virtual void save(std::ostream& os) const = 0;
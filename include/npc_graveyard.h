@@ -0,0 +1,60 @@
+#pragma once
+
+#include "npc_types.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+class NpcGraveyard;
+
+// Метка эпохи: пока она жива, NPC, убранные из хранилища после её взятия,
+// не освобождаются. Снимок держит простые указатели и не трогает счётчики
+// shared_ptr.
+class NpcPin {
+private:
+    NpcGraveyard* owner = nullptr;
+    uint64_t epoch = 0;
+
+public:
+    NpcPin() = default;
+    NpcPin(NpcGraveyard* owner, uint64_t epoch) : owner(owner), epoch(epoch) {}
+    NpcPin(NpcPin&& other) noexcept : owner(std::exchange(other.owner, nullptr)), epoch(other.epoch) {}
+    NpcPin& operator=(NpcPin&& other) noexcept {
+        if (this != &other) {
+            reset();
+            owner = std::exchange(other.owner, nullptr);
+            epoch = other.epoch;
+        }
+        return *this;
+    }
+    ~NpcPin() { reset(); }
+    void reset();
+    bool pinned() const { return owner != nullptr; }
+
+    NpcPin(const NpcPin&) = delete;
+    NpcPin& operator=(const NpcPin&) = delete;
+};
+
+// Отложенное освобождение убранных NPC. Метка берётся до чтения хранилища,
+// bury - после удаления из него: NPC, похороненный в эпоху e, освобождается,
+// когда сняты все метки с эпохой не позже e.
+class NpcGraveyard {
+private:
+    mutable std::mutex mutex;
+    uint64_t epoch = 0;
+    std::map<uint64_t, size_t> pins;   // эпоха -> живые метки
+    std::vector<std::pair<uint64_t, std::shared_ptr<BaseNpc>>> buried;
+
+    // Под mutex; освобождаемые уходят в freed, чтобы деструкторы шли без замка
+    void collect(std::vector<std::shared_ptr<BaseNpc>>& freed);
+
+public:
+    NpcPin pin();
+    void unpin(uint64_t pin_epoch);
+    // Забирает npcs; их освобождает последний, кто снимет мешающую метку
+    void bury(std::vector<std::shared_ptr<BaseNpc>>& npcs);
+    size_t buried_count() const;
+};
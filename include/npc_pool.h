@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct PoolStats {
+    size_t slot_allocations = 0;      // выдано слотов всего
+    size_t slot_reuses = 0;           // из них взято из списка свободных
+    size_t block_allocations = 0;     // обращений к общему аллокатору за блоками
+    size_t fallback_allocations = 0;  // запросы, не поместившиеся в слот
+    size_t live_slots = 0;
+    size_t reserved_slots = 0;
+
+    PoolStats& operator+=(const PoolStats& other);
+};
+
+// Пул слотов фиксированного размера для NPC одного типа.
+// Размер слота фиксируется первым запросом (allocate_shared кладёт объект
+// и блок управления в одну аллокацию). Освобождённые слоты переиспользуются.
+class NpcPool {
+private:
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    size_t slot_size = 0;
+    size_t slots_per_block;
+    std::vector<void*> blocks;
+    FreeSlot* free_list = nullptr;
+    char* bump = nullptr;
+    size_t bump_left = 0;
+    PoolStats stats;
+    mutable std::mutex mutex;
+
+    void grow();
+
+public:
+    explicit NpcPool(size_t slots_per_block = 256);
+    ~NpcPool();
+
+    void* allocate(size_t bytes);
+    void deallocate(void* ptr, size_t bytes);
+
+    // Возвращает все блоки общему аллокатору, если живых слотов не осталось
+    bool release();
+    PoolStats get_stats() const;
+
+    NpcPool(const NpcPool&) = delete;
+    NpcPool& operator=(const NpcPool&) = delete;
+};
+
+// Аллокатор для std::allocate_shared. Держит пул через shared_ptr,
+// поэтому пул живёт, пока жив хотя бы один выданный из него NPC.
+template <class T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    std::shared_ptr<NpcPool> pool;
+
+    explicit PoolAllocator(std::shared_ptr<NpcPool> pool) : pool(std::move(pool)) {}
+
+    template <class U>
+    PoolAllocator(const PoolAllocator<U>& other) : pool(other.pool) {}
+
+    static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned types are not supported");
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(pool->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) {
+        pool->deallocate(ptr, n * sizeof(T));
+    }
+
+    template <class U>
+    bool operator==(const PoolAllocator<U>& other) const { return pool == other.pool; }
+    template <class U>
+    bool operator!=(const PoolAllocator<U>& other) const { return pool != other.pool; }
+};
@@ -1,64 +1,103 @@
 #pragma once
 
 #include "npc.h"
+#include "species.h"
 #include "visitor.h"
 #include "observer.h"
 #include <memory>
 #include <random>
 #include <vector>
 #include <ostream>
-#include <atomic>  
+#include <atomic>
+#include <algorithm>
 
+// Единственная реализация INpc. Поведение вида берётся из реестра видов
+// по тегу, методы помечены final: через BaseNpc* вызовы девиртуализуются
+// и встраиваются, а INpc остаётся адаптером для остального кода.
 class BaseNpc : public INpc, public std::enable_shared_from_this<BaseNpc> {
 protected:
-    Position position;
-    std::string name;
+    std::atomic<Position> position;   // читается без замков, пока поток региона двигает NPC
+    NameId name;
     NpcType type;
-    std::atomic<bool> alive{true}; 
-    mutable std::mt19937 rng;
+    std::atomic<bool> alive{true};
+    mutable NpcRng rng;
     std::vector<std::shared_ptr<IObserver>> observers;
-    
+
+    void read_body(std::istream& is);
+
 public:
     BaseNpc(NpcType type, const std::string& name, int x, int y);
-    Position get_position() const override;
-    std::string get_name() const override;
-    NpcType get_type() const override;
-    std::string get_type_str() const override;
-    std::string info() const override;
-    bool is_alive() const override;
-    void kill() override;
-    bool accept(const std::shared_ptr<IVisitor>& visitor) override;
-    void move() override;
-    MovementConfig get_movement_config() const override;
-    int roll_dice() const override;
-    void save(std::ostream& os) const override;
-    void subscribe(const std::shared_ptr<IObserver>& observer) override;
-    void notify_kill(const std::shared_ptr<INpc>& victim) override;
-    
-protected:
-    virtual void specific_move() = 0;
+    BaseNpc(NpcType type, NameId name, int x, int y);
+    BaseNpc(NpcType type, NameId name, int x, int y, uint32_t rng_seed);
+    BaseNpc(NpcType type, std::istream& is);
+
+    Position get_position() const final { return position.load(std::memory_order_relaxed); }
+    NameId get_name_id() const final { return name; }
+    NpcType get_type() const final { return type; }
+    bool is_alive() const final { return alive.load(); }
+    void kill() final { alive.store(false); }
+    bool try_kill() final {
+        bool expected = true;
+        return alive.compare_exchange_strong(expected, false);
+    }
+    MovementConfig get_movement_config() const final { return species(type).movement; }
+    std::string_view get_type_str() const final { return species(type).name; }
+
+    int roll_dice() const final {
+        std::uniform_int_distribution<int> dist(1, species(type).dice_sides);
+        return dist(rng);
+    }
+
+    void move(const GameConfig& bounds) final {
+        if (!is_alive()) return;
+        Position next = get_position();
+        next.random_move(species(type).movement.move_distance, rng);
+        next.x = bounds.clamp_x(next.x);
+        next.y = bounds.clamp_y(next.y);
+        position.store(next, std::memory_order_relaxed);
+    }
+
+    // Шаг к цели: по каждой оси не дальше move_distance, как и у случайного шага
+    void move_towards(const Position& target, const GameConfig& bounds) {
+        if (!is_alive()) return;
+        int step = species(type).movement.move_distance;
+        Position next = get_position();
+        next.x += std::max(-step, std::min(step, target.x - next.x));
+        next.y += std::max(-step, std::min(step, target.y - next.y));
+        next.x = bounds.clamp_x(next.x);
+        next.y = bounds.clamp_y(next.y);
+        position.store(next, std::memory_order_relaxed);
+    }
+
+    std::string get_name() const final;
+    std::string info() const final;
+    void print_info(std::ostream& os) const final;
+    bool accept(const std::shared_ptr<IVisitor>& visitor) final;
+    void save(std::ostream& os) const final;
+    void subscribe(const std::shared_ptr<IObserver>& observer) final;
+    void notify_kill(const std::shared_ptr<INpc>& victim) final;
 };
 
 class Dragon : public BaseNpc {
 public:
     Dragon(const std::string& name, int x, int y);
+    Dragon(NameId name, int x, int y);
+    Dragon(NameId name, int x, int y, uint32_t rng_seed);
     Dragon(std::istream& is);
-protected:
-    void specific_move() override;
 };
 
 class Frog : public BaseNpc {
 public:
     Frog(const std::string& name, int x, int y);
+    Frog(NameId name, int x, int y);
+    Frog(NameId name, int x, int y, uint32_t rng_seed);
     Frog(std::istream& is);
-protected:
-    void specific_move() override;
 };
 
 class Bull : public BaseNpc {
 public:
     Bull(const std::string& name, int x, int y);
+    Bull(NameId name, int x, int y);
+    Bull(NameId name, int x, int y, uint32_t rng_seed);
     Bull(std::istream& is);
-protected:
-    void specific_move() override;
-};
\ No newline at end of file
+};
@@ -1,31 +1,55 @@
 #pragma once
 
 #include "npc.h"
+#include "slot_map.h"
 #include <iostream>
 #include <fstream>
 #include <memory>
 #include <mutex>
 #include <chrono>
+#include <cstdint>
+#include <string>
 #include <iomanip>
 
+// Событие убийства в игре: дескрипторы и имена вместо владеющих указателей
+struct KillEvent {
+    NpcHandle killer;
+    NpcHandle victim;
+    NameId killer_name;
+    NameId victim_name;
+};
+
 class IObserver {
 public:
     virtual ~IObserver() = default;
     virtual void on_kill(const std::shared_ptr<INpc>& killer, const std::shared_ptr<INpc>& victim) = 0;
+    virtual void on_kill_event(const KillEvent& event) { (void)event; }
 };
 
 class ConsoleObserver : public IObserver {
 private:
     mutable std::mutex mutex;
+    void log(const NameId& killer, const NameId& victim);
 public:
     void on_kill(const std::shared_ptr<INpc>& killer, const std::shared_ptr<INpc>& victim) override;
+    void on_kill_event(const KillEvent& event) override;
 };
 
+// Журнал в файл. С ротацией файл, доросший до max_bytes, становится
+// filename.1 (старые сдвигаются до filename.keep_files), и запись идёт в новый.
 class FileObserver : public IObserver {
 private:
     std::string filename;
     mutable std::mutex mutex;
+    uintmax_t max_bytes = 0;   // 0 - без ротации
+    size_t keep_files = 0;
+    uintmax_t size = 0;
+    bool size_known = false;
+    void log(const NameId& killer, const NameId& victim);
+    void rotate();
 public:
     FileObserver(const std::string& filename = "log.txt") : filename(filename) {}
+    void set_rotation(uintmax_t max_bytes, size_t keep_files);
     void on_kill(const std::shared_ptr<INpc>& killer, const std::shared_ptr<INpc>& victim) override;
+    void on_kill_event(const KillEvent& event) override;
 };
\ No newline at end of file
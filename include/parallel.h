@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+inline size_t default_thread_count() {
+    unsigned hardware = std::thread::hardware_concurrency();
+    return hardware ? hardware : 1;
+}
+
+// Делит [0, count) на thread_count непрерывных кусков и вызывает
+// body(chunk, begin, end) для каждого в своём потоке (нулевой - в вызывающем).
+// Разбиение зависит только от count и thread_count, поэтому результаты,
+// собранные по номеру куска, детерминированы.
+template <class Body>
+void parallel_for_chunks(size_t count, size_t thread_count, Body&& body) {
+    thread_count = std::max<size_t>(1, std::min(thread_count, count));
+    if (thread_count == 1) {
+        if (count > 0) body(size_t(0), size_t(0), count);
+        return;
+    }
+
+    size_t chunk_size = (count + thread_count - 1) / thread_count;
+    std::vector<std::exception_ptr> errors(thread_count);
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+
+    auto run = [&](size_t chunk) {
+        size_t begin = chunk * chunk_size;
+        size_t end = std::min(count, begin + chunk_size);
+        try {
+            if (begin < end) body(chunk, begin, end);
+        } catch (...) {
+            errors[chunk] = std::current_exception();
+        }
+    };
+
+    for (size_t chunk = 1; chunk < thread_count; ++chunk) {
+        threads.emplace_back(run, chunk);
+    }
+    run(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+// Те же куски, что у parallel_for_chunks, но на потоках, которые живут между
+// вызовами: каждый тик не создаёт и не ждёт новые std::thread. Нулевой кусок
+// берёт вызывающий поток; потоки добавляются, когда кусков стало больше.
+class WorkerPool {
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::mutex run_mutex;                       // один run за раз
+    const std::function<void(size_t)>* job = nullptr;
+    size_t next_chunk = 0;
+    size_t chunk_total = 0;
+    size_t pending = 0;
+    bool stopping = false;
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&] { return stopping || next_chunk < chunk_total; });
+            if (stopping) return;
+            size_t chunk = next_chunk++;
+            lock.unlock();
+            (*job)(chunk);
+            lock.lock();
+            if (--pending == 0) finished.notify_one();
+        }
+    }
+
+public:
+    WorkerPool() = default;
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    size_t size() const { return workers.size(); }
+
+    template <class Body>
+    void run(size_t count, size_t thread_count, Body&& body) {
+        thread_count = std::max<size_t>(1, std::min(thread_count, count));
+        if (thread_count == 1) {
+            if (count > 0) body(size_t(0), size_t(0), count);
+            return;
+        }
+
+        std::lock_guard<std::mutex> serial(run_mutex);
+        size_t chunk_size = (count + thread_count - 1) / thread_count;
+        std::vector<std::exception_ptr> errors(thread_count);
+        std::function<void(size_t)> run_chunk = [&](size_t chunk) {
+            size_t begin = chunk * chunk_size;
+            size_t end = std::min(count, begin + chunk_size);
+            try {
+                if (begin < end) body(chunk, begin, end);
+            } catch (...) {
+                errors[chunk] = std::current_exception();
+            }
+        };
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (workers.size() < thread_count - 1) {
+                workers.emplace_back(&WorkerPool::work, this);
+            }
+            job = &run_chunk;
+            next_chunk = 1;
+            chunk_total = thread_count;
+            pending = thread_count - 1;
+        }
+        wake.notify_all();
+        run_chunk(0);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&] { return pending == 0; });
+            job = nullptr;
+            chunk_total = 0;
+            next_chunk = 0;
+        }
+
+        for (auto& error : errors) {
+            if (error) std::rethrow_exception(error);
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+};
+
+// Стратегия выполнения пакетной работы боевого движка.
+// ordered() == true означает, что результат должен совпадать с однопоточным.
+class IExecutionPolicy {
+public:
+    using ChunkBody = std::function<void(size_t chunk, size_t begin, size_t end)>;
+
+    virtual ~IExecutionPolicy() = default;
+    virtual size_t chunk_count(size_t items) const = 0;
+    virtual void run(size_t items, const ChunkBody& body) const = 0;
+    virtual bool ordered() const = 0;
+};
+
+class SerialPolicy : public IExecutionPolicy {
+public:
+    size_t chunk_count(size_t items) const override { return items ? 1 : 0; }
+    void run(size_t items, const ChunkBody& body) const override { parallel_for_chunks(items, 1, body); }
+    bool ordered() const override { return true; }
+};
+
+// Куски по min_items_per_thread и больше; порядок внутри куска не фиксирован
+class ParallelPolicy : public IExecutionPolicy {
+protected:
+    size_t thread_count;
+    size_t min_items_per_thread;
+public:
+    explicit ParallelPolicy(size_t thread_count = default_thread_count(), size_t min_items_per_thread = 256)
+        : thread_count(std::max<size_t>(1, thread_count)), min_items_per_thread(std::max<size_t>(1, min_items_per_thread)) {}
+
+    size_t chunk_count(size_t items) const override {
+        return std::min(items, std::min(thread_count, items / min_items_per_thread + 1));
+    }
+    void run(size_t items, const ChunkBody& body) const override {
+        parallel_for_chunks(items, chunk_count(items), body);
+    }
+    bool ordered() const override { return false; }
+};
+
+// Многопоточно, но с результатом, совпадающим с SerialPolicy
+class DeterministicPolicy : public ParallelPolicy {
+public:
+    using ParallelPolicy::ParallelPolicy;
+    bool ordered() const override { return true; }
+};
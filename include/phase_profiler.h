@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// Фазы тика. Замеры вложены: TICK - весь тик движения без паузы, в нём
+// MOVEMENT и COLLISIONS, а COLLISIONS включает QUEUE_PUSH. Поток боёв пишет
+// QUEUE_DRAIN, BATTLE, LOGGING (отчёт и журнал убийств), CONSOLE (вывод
+// отчёта), CLEANUP и RESPAWN - каждую не больше раза за проход.
+enum class TickPhase : uint8_t {
+    TICK,
+    MOVEMENT,
+    COLLISIONS,
+    QUEUE_PUSH,
+    QUEUE_DRAIN,
+    BATTLE,
+    LOGGING,
+    CONSOLE,
+    CLEANUP,
+    RESPAWN,
+    COUNT
+};
+
+const size_t TICK_PHASE_COUNT = static_cast<size_t>(TickPhase::COUNT);
+
+const char* phase_name(TickPhase phase);
+
+struct PhaseStats {
+    uint64_t count = 0;
+    uint64_t p50_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t max_ns = 0;
+};
+
+// Лог-линейная гистограмма длительностей в наносекундах: корзина - степень
+// двойки, поделённая на 8 частей, так что процентиль верен с точностью 1/8.
+// Пишет один поток (обычные load/store без RMW), читать можно из любого.
+class PhaseHistogram {
+public:
+    static constexpr size_t SUB_BUCKETS = 8;
+    static constexpr size_t BUCKETS = (64 - 2) * SUB_BUCKETS;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+    std::atomic<uint64_t> max_ns{0};
+
+public:
+    static size_t bucket_of(uint64_t ns);
+    // Наибольшее значение, попадающее в корзину
+    static uint64_t bucket_limit(size_t bucket);
+
+    void record(uint64_t ns) {
+        auto& bucket = buckets[bucket_of(ns)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (ns > max_ns.load(std::memory_order_relaxed)) {
+            max_ns.store(ns, std::memory_order_relaxed);
+        }
+    }
+    // Прибавляет свои счётчики к counts (размер BUCKETS), max - наибольшее
+    void add_to(std::vector<uint64_t>& counts, uint64_t& max) const;
+    void clear();
+};
+
+// Гистограммы фаз по потокам. Поток получает свой набор при первой записи
+// (единственный замок) и возвращает его в общий список при завершении,
+// поэтому наборов не больше, чем потоков, живших одновременно. Запись -
+// без замков и атомарных RMW; stats() сводит наборы всех потоков.
+class PhaseProfiler {
+public:
+    struct ThreadHistograms {
+        std::array<PhaseHistogram, TICK_PHASE_COUNT> phases;
+        std::atomic<bool> in_use{false};
+    };
+
+private:
+    std::vector<std::unique_ptr<ThreadHistograms>> threads;
+    mutable std::mutex threads_mutex;
+
+    PhaseProfiler() = default;
+
+public:
+    static PhaseProfiler& instance();
+
+    ThreadHistograms& acquire();
+    void release(ThreadHistograms& histograms);
+    void record(TickPhase phase, uint64_t ns);
+
+    std::array<PhaseStats, TICK_PHASE_COUNT> stats() const;
+    void reset();
+    void print(std::ostream& os) const;
+
+    PhaseProfiler(const PhaseProfiler&) = delete;
+    PhaseProfiler& operator=(const PhaseProfiler&) = delete;
+};
+
+// Замер области видимости: от конструктора до деструктора
+class PhaseTimer {
+private:
+    TickPhase phase;
+    std::chrono::steady_clock::time_point started;
+
+public:
+    explicit PhaseTimer(TickPhase phase) : phase(phase), started(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - started;
+        PhaseProfiler::instance().record(
+            phase, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+};
+
+// PHASE_TIMER(TickPhase::X) замеряет остаток блока. Без BALAGUR_PHASE_PROFILER
+// (опция CMake ENABLE_PHASE_PROFILER) макрос пуст: ни часов, ни записи.
+#define PHASE_TIMER_CONCAT_(a, b) a##b
+#define PHASE_TIMER_NAME_(line) PHASE_TIMER_CONCAT_(phase_timer_, line)
+#ifdef BALAGUR_PHASE_PROFILER
+#define PHASE_PROFILER_ENABLED 1
+#define PHASE_TIMER(phase) PhaseTimer PHASE_TIMER_NAME_(__LINE__)(phase)
+#else
+#define PHASE_PROFILER_ENABLED 0
+#define PHASE_TIMER(phase) static_cast<void>(0)
+#endif
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// 64-битный дескриптор: 32 бита индекса слота + 32 бита поколения.
+// Поколение слота растёт при каждом удалении, поэтому устаревший
+// дескриптор определяется одним сравнением. Слот, чьё поколение дошло до
+// предела, больше не выдаётся, так что поколения не повторяются никогда.
+struct SlotHandle {
+    static constexpr uint32_t INDEX_BITS = 32;
+    static constexpr uint32_t INDEX_MASK = std::numeric_limits<uint32_t>::max();
+    static constexpr uint32_t GENERATION_MASK = std::numeric_limits<uint32_t>::max();
+    static constexpr uint64_t INVALID = std::numeric_limits<uint64_t>::max();
+
+    uint64_t value = INVALID;
+
+    SlotHandle() = default;
+    explicit SlotHandle(uint64_t value) : value(value) {}
+    SlotHandle(uint32_t index, uint32_t generation)
+        : value((static_cast<uint64_t>(generation) << INDEX_BITS) | index) {}
+
+    uint32_t index() const { return static_cast<uint32_t>(value & INDEX_MASK); }
+    uint32_t generation() const { return static_cast<uint32_t>(value >> INDEX_BITS); }
+    bool valid() const { return value != INVALID; }
+
+    bool operator==(const SlotHandle& other) const { return value == other.value; }
+    bool operator!=(const SlotHandle& other) const { return value != other.value; }
+};
+
+using NpcHandle = SlotHandle;
+
+// Плотный массив значений + разреженная таблица слотов.
+// Итерация идёт по плотному массиву, доступ по дескриптору - O(1).
+template <class T>
+class SlotMap {
+private:
+    static const uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    struct Slot {
+        uint32_t dense = NONE;      // индекс в values или следующий свободный слот
+        uint32_t generation = 0;
+        bool occupied = false;
+    };
+
+    std::vector<T> values;
+    std::vector<uint32_t> dense_to_slot;
+    std::vector<Slot> slots;
+    uint32_t free_head = NONE;
+    uint32_t free_tail = NONE;
+    size_t retired = 0;
+
+    void push_free(uint32_t slot_index) {
+        Slot& slot = slots[slot_index];
+        slot.occupied = false;
+        slot.dense = NONE;
+        // Исчерпанный слот выводится из оборота: иначе поколение пошло бы по кругу
+        if (slot.generation == SlotHandle::GENERATION_MASK) {
+            ++retired;
+            return;
+        }
+        ++slot.generation;
+        if (free_tail == NONE) {
+            free_head = slot_index;
+        } else {
+            slots[free_tail].dense = slot_index;
+        }
+        free_tail = slot_index;
+    }
+
+    uint32_t pop_free() {
+        if (free_head == NONE) {
+            if (slots.size() >= SlotHandle::INDEX_MASK) {
+                throw std::length_error("SlotMap capacity exceeded");
+            }
+            slots.emplace_back();
+            return static_cast<uint32_t>(slots.size() - 1);
+        }
+        uint32_t slot_index = free_head;
+        free_head = slots[slot_index].dense;
+        if (free_head == NONE) {
+            free_tail = NONE;
+        }
+        return slot_index;
+    }
+
+public:
+    using iterator = typename std::vector<T>::iterator;
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+    SlotHandle insert(T value) {
+        uint32_t slot_index = pop_free();
+        Slot& slot = slots[slot_index];
+        slot.dense = static_cast<uint32_t>(values.size());
+        slot.occupied = true;
+        values.push_back(std::move(value));
+        dense_to_slot.push_back(slot_index);
+        return SlotHandle(slot_index, slot.generation);
+    }
+
+    bool contains(SlotHandle handle) const {
+        if (!handle.valid() || handle.index() >= slots.size()) return false;
+        const Slot& slot = slots[handle.index()];
+        return slot.occupied && slot.generation == handle.generation();
+    }
+
+    T* get(SlotHandle handle) {
+        return contains(handle) ? &values[slots[handle.index()].dense] : nullptr;
+    }
+
+    const T* get(SlotHandle handle) const {
+        return contains(handle) ? &values[slots[handle.index()].dense] : nullptr;
+    }
+
+    // Удаление перестановкой последнего элемента на место удалённого: O(1)
+    bool erase(SlotHandle handle) {
+        if (!contains(handle)) return false;
+        uint32_t dense = slots[handle.index()].dense;
+        uint32_t last = static_cast<uint32_t>(values.size() - 1);
+        if (dense != last) {
+            values[dense] = std::move(values[last]);
+            dense_to_slot[dense] = dense_to_slot[last];
+            slots[dense_to_slot[dense]].dense = dense;
+        }
+        values.pop_back();
+        dense_to_slot.pop_back();
+        push_free(handle.index());
+        return true;
+    }
+
+    // Удаление по условию с сохранением порядка оставшихся элементов
+    template <class Predicate>
+    size_t erase_if(Predicate predicate) {
+        size_t write = 0;
+        for (size_t read = 0; read < values.size(); ++read) {
+            if (predicate(values[read])) {
+                push_free(dense_to_slot[read]);
+                continue;
+            }
+            if (write != read) {
+                values[write] = std::move(values[read]);
+                dense_to_slot[write] = dense_to_slot[read];
+            }
+            slots[dense_to_slot[write]].dense = static_cast<uint32_t>(write);
+            ++write;
+        }
+        size_t removed = values.size() - write;
+        values.resize(write);
+        dense_to_slot.resize(write);
+        return removed;
+    }
+
+    // Переставляет плотный массив: на место k встаёт элемент с индексом order[k].
+    // Дескрипторы остаются прежними, меняется только порядок обхода.
+    void reorder(const std::vector<uint32_t>& order) {
+        if (order.size() != values.size()) {
+            throw std::invalid_argument("SlotMap reorder size mismatch");
+        }
+        std::vector<T> new_values;
+        std::vector<uint32_t> new_dense_to_slot;
+        new_values.reserve(values.size());
+        new_dense_to_slot.reserve(values.size());
+        for (size_t k = 0; k < order.size(); ++k) {
+            new_values.push_back(std::move(values[order[k]]));
+            new_dense_to_slot.push_back(dense_to_slot[order[k]]);
+            slots[new_dense_to_slot.back()].dense = static_cast<uint32_t>(k);
+        }
+        values.swap(new_values);
+        dense_to_slot.swap(new_dense_to_slot);
+    }
+
+    void clear() {
+        for (uint32_t slot_index : dense_to_slot) {
+            push_free(slot_index);
+        }
+        values.clear();
+        dense_to_slot.clear();
+    }
+
+    void reserve(size_t count) {
+        values.reserve(count);
+        dense_to_slot.reserve(count);
+        slots.reserve(count);
+    }
+
+    SlotHandle handle_at(size_t dense_index) const {
+        uint32_t slot_index = dense_to_slot[dense_index];
+        return SlotHandle(slot_index, slots[slot_index].generation);
+    }
+
+    T& operator[](size_t dense_index) { return values[dense_index]; }
+    const T& operator[](size_t dense_index) const { return values[dense_index]; }
+
+    const std::vector<T>& dense_values() const { return values; }
+    size_t retired_slots() const { return retired; }
+    size_t size() const { return values.size(); }
+    bool empty() const { return values.empty(); }
+
+    iterator begin() { return values.begin(); }
+    iterator end() { return values.end(); }
+    const_iterator begin() const { return values.begin(); }
+    const_iterator end() const { return values.end(); }
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "npc.h"
+#include "distance_kernel.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Пространственный индекс над снимком координат (PositionBlock).
+// Запросы возвращают индексы точек снимка; порядок не гарантируется.
+class ISpatialIndex {
+public:
+    virtual ~ISpatialIndex() = default;
+    virtual void build(const PositionBlock& positions) = 0;
+    // Точно в пределах range (dx*dx + dy*dy <= range*range)
+    virtual void query_radius(const Position& center, int range, std::vector<uint32_t>& out) const = 0;
+    // Включительно по обеим границам
+    virtual void query_rect(int min_x, int min_y, int max_x, int max_y, std::vector<uint32_t>& out) const = 0;
+};
+
+// Разреженная равномерная сетка в виде CSR: точки отсортированы по ключу
+// занятой ячейки (строка, столбец), пустые ячейки не хранятся, поэтому память
+// растёт с числом точек, а не с площадью. Ячейки одной строки лежат подряд:
+// полоса ячеек находится двумя бинарными поисками и проверяется ядром дальности целиком.
+class SpatialGrid : public ISpatialIndex {
+private:
+    int cell_size;
+    int min_x = 0;
+    int min_y = 0;
+    int max_x = -1;
+    int max_y = -1;
+    std::vector<uint64_t> cell_keys;      // занятые ячейки по возрастанию
+    std::vector<uint32_t> cell_start;     // cell_keys.size() + 1 границ
+    std::vector<uint32_t> order;
+    PositionBlock sorted;
+
+    uint32_t column_of(int x) const;
+    uint32_t row_of(int y) const;
+    template <class Visit>
+    void for_each_row_span(int min_x, int min_y, int max_x, int max_y, Visit&& visit) const;
+
+public:
+    explicit SpatialGrid(int cell_size = 16);
+
+    void set_cell_size(int size) { cell_size = size > 0 ? size : 1; }
+    int get_cell_size() const { return cell_size; }
+    // Число занятых ячеек
+    size_t cell_count() const { return cell_keys.size(); }
+
+    void build(const PositionBlock& positions) override;
+    void query_radius(const Position& center, int range, std::vector<uint32_t>& out) const override;
+    void query_rect(int min_x, int min_y, int max_x, int max_y, std::vector<uint32_t>& out) const override;
+};
+
+struct Neighbour {
+    int64_t distance_sq;
+    uint32_t id;
+
+    bool operator<(const Neighbour& other) const {
+        return distance_sq != other.distance_sq ? distance_sq < other.distance_sq : id < other.id;
+    }
+};
+
+// Квадродерево над точками с устойчивыми номерами (id). Лист делится, когда
+// в нём больше LEAF_CAPACITY точек, и поддерево схлопывается обратно, когда
+// в нём остаётся не больше MERGE_THRESHOLD точек, поэтому плотные скопления
+// получают мелкие узлы, а пустые области - один крупный. build() нумерует
+// точки по индексу в снимке; insert/erase/update меняют дерево по одной точке.
+class QuadTree : public ISpatialIndex {
+public:
+    static constexpr uint32_t LEAF_CAPACITY = 64;
+    static constexpr uint32_t MERGE_THRESHOLD = LEAF_CAPACITY / 2;
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Node {
+        int64_t min_x = 0;
+        int64_t min_y = 0;
+        int64_t size = 1;              // сторона квадрата
+        uint32_t parent = NONE;
+        uint32_t first_child = NONE;   // четыре потомка подряд; NONE у листа
+        uint32_t count = 0;            // точек в поддереве
+        PositionBlock points;          // только у листа
+        std::vector<uint32_t> ids;
+
+        bool is_leaf() const { return first_child == NONE; }
+        bool covers(int x, int y) const {
+            return x >= min_x && x < min_x + size && y >= min_y && y < min_y + size;
+        }
+    };
+
+    std::vector<Node> nodes;              // nodes[0] - корень
+    std::vector<uint32_t> free_groups;    // освобождённые четвёрки узлов
+    std::vector<uint32_t> leaf_of;        // id -> лист
+    std::vector<uint32_t> slot_of;        // id -> место в листе
+    size_t item_count = 0;
+
+    uint32_t allocate_group(uint32_t parent);
+    void free_subtree(uint32_t node);
+    void grow_to(int x, int y);
+    uint32_t find_leaf(int x, int y) const;
+    void add_to_leaf(uint32_t leaf, uint32_t id, const Position& pos);
+    void remove_from_leaf(uint32_t leaf, uint32_t slot);
+    void split(uint32_t leaf);
+    void collapse(uint32_t node);
+    void gather(uint32_t node, uint32_t into);
+    template <class Visit>
+    void for_each_leaf(int64_t min_x, int64_t min_y, int64_t max_x, int64_t max_y, Visit&& visit) const;
+
+public:
+    QuadTree();
+
+    void clear();
+    void build(const PositionBlock& positions) override;
+    void query_radius(const Position& center, int range, std::vector<uint32_t>& out) const override;
+    void query_rect(int min_x, int min_y, int max_x, int max_y, std::vector<uint32_t>& out) const override;
+
+    void insert(uint32_t id, const Position& pos);
+    bool erase(uint32_t id);
+    // Точка, оставшаяся в своём листе, обновляется на месте
+    void update(uint32_t id, const Position& pos);
+    bool contains(uint32_t id) const { return id < leaf_of.size() && leaf_of[id] != NONE; }
+    // Координаты точки id; id должен быть в дереве
+    Position position(uint32_t id) const {
+        const PositionBlock& points = nodes[leaf_of[id]].points;
+        return {points.xs[slot_of[id]], points.ys[slot_of[id]]};
+    }
+    // До k ближайших к center не дальше sqrt(max_distance_sq), по возрастанию
+    // расстояния, при равенстве - по id. Узлы обходятся от ближнего к дальнему,
+    // и обход останавливается, когда ближайший узел дальше k-го найденного.
+    void nearest(const Position& center, size_t k, std::vector<Neighbour>& out,
+                 int64_t max_distance_sq = INT64_MAX) const;
+
+    size_t size() const { return item_count; }
+    size_t node_count() const { return nodes.size() - free_groups.size() * 4; }
+    size_t leaf_count() const;
+};
+
+enum class SpatialIndexKind {
+    GRID,
+    QUADTREE
+};
+
+// cell_size - размер ячейки сетки; дерево подбирает размеры узлов само
+std::unique_ptr<ISpatialIndex> make_spatial_index(SpatialIndexKind kind, int cell_size);
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "npc.h"
+#include "kill_rules.h"
+#include <array>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Параметры вида: всё, чем виды отличаются друг от друга
+struct SpeciesTraits {
+    NpcType type;
+    std::string_view name;          // в файлах сохранения
+    std::string_view display_name;  // основа имени по умолчанию
+    char symbol;                    // на карте
+    MovementConfig movement;
+    int dice_sides;
+};
+
+// Встроенные виды; всегда занимают первые NPC_TYPE_COUNT номеров реестра
+constexpr std::array<SpeciesTraits, NPC_TYPE_COUNT> BUILTIN_SPECIES = {{
+    {NpcType::DRAGON, "dragon", "Dragon", 'D', DRAGON_CONFIG, DICE_SIDES},
+    {NpcType::FROG, "frog", "Frog", 'F', FROG_CONFIG, DICE_SIDES},
+    {NpcType::BULL, "bull", "Bull", 'B', BULL_CONFIG, DICE_SIDES},
+}};
+
+static_assert(BUILTIN_SPECIES[static_cast<size_t>(NpcType::DRAGON)].type == NpcType::DRAGON, "");
+static_assert(BUILTIN_SPECIES[static_cast<size_t>(NpcType::FROG)].type == NpcType::FROG, "");
+static_assert(BUILTIN_SPECIES[static_cast<size_t>(NpcType::BULL)].type == NpcType::BULL, "");
+
+struct Species {
+    SpeciesTraits traits;
+    TypeMask prey;
+};
+
+// Реестр видов, читаемый из конфигурации при запуске.
+// Формат (пустые строки и '#' пропускаются):
+//   species <name> <DisplayName> <symbol> <move_distance> <kill_distance> [dice_sides]
+//   kills <attacker> <victim>...
+// Встроенные виды можно переопределить по имени. Реестр меняется только
+// до старта игры: горячие циклы читают его без блокировок.
+class SpeciesRegistry {
+private:
+    std::vector<Species> table;
+
+    Species& add_or_update(const SpeciesTraits& traits);
+
+public:
+    SpeciesRegistry();
+
+    static SpeciesRegistry& instance() {
+        static SpeciesRegistry registry;
+        return registry;
+    }
+
+    void load_defaults();
+    void load(std::istream& in);
+    bool load_from_file(const std::string& filename);
+
+    const Species& get(NpcType type) const { return table[static_cast<size_t>(type)]; }
+    size_t size() const { return table.size(); }
+    bool contains(NpcType type) const { return static_cast<size_t>(type) < table.size(); }
+    bool find(std::string_view name, NpcType& type) const;
+
+    const TypeMask& prey(NpcType attacker) const { return get(attacker).prey; }
+    bool can_kill(NpcType attacker, NpcType victim) const {
+        return get(attacker).prey[static_cast<size_t>(victim)];
+    }
+    // Наибольшая дистанция атаки среди видов, у которых есть добыча
+    int max_kill_distance() const;
+};
+
+inline const SpeciesTraits& species(NpcType type) {
+    return SpeciesRegistry::instance().get(type).traits;
+}
+
+inline const TypeMask& prey_mask(NpcType attacker) {
+    return SpeciesRegistry::instance().prey(attacker);
+}
+
+inline bool can_kill(NpcType attacker, NpcType victim) {
+    return SpeciesRegistry::instance().can_kill(attacker, victim);
+}
+
+inline bool species_from_name(std::string_view name, NpcType& type) {
+    return SpeciesRegistry::instance().find(name, type);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "spatial_index.h"
+#include "kill_rules.h"
+#include <cstdint>
+#include <vector>
+
+// Отдельное квадродерево на каждый вид NPC. Запрос по маске видов обходит
+// только деревья нужных видов, поэтому хищник ищет добычу, не перебирая
+// NPC, которых он не может убить.
+class TypedIndex {
+private:
+    static constexpr uint16_t NO_TYPE = UINT16_MAX;
+
+    std::vector<QuadTree> trees;     // по номеру вида
+    std::vector<uint16_t> type_of;   // id -> вид
+    size_t item_count = 0;
+
+    template <class Visit>
+    void for_each_tree(const TypeMask& types, Visit&& visit) const {
+        for (size_t t = 0; t < trees.size(); ++t) {
+            if (types[t] && trees[t].size() > 0) visit(trees[t]);
+        }
+    }
+
+public:
+    void clear();
+    // Вставляет точку или переносит её; id, сменивший вид, переезжает в другое дерево
+    void update(uint32_t id, NpcType type, const Position& pos);
+    bool erase(uint32_t id);
+    bool contains(uint32_t id) const { return id < type_of.size() && type_of[id] != NO_TYPE; }
+    // Координаты id; id должен быть в индексе
+    Position position(uint32_t id) const { return trees[type_of[id]].position(id); }
+    size_t size() const { return item_count; }
+
+    // До k ближайших NPC видов из types, по возрастанию расстояния, при равенстве - по id
+    void nearest(const Position& center, const TypeMask& types, size_t k, std::vector<Neighbour>& out,
+                 int64_t max_distance_sq = INT64_MAX) const;
+    void query_radius(const Position& center, int range, const TypeMask& types, std::vector<uint32_t>& out) const;
+    void query_rect(int min_x, int min_y, int max_x, int max_y, const TypeMask& types,
+                    std::vector<uint32_t>& out) const;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "battle.h"
+#include "constants.h"
+#include "parallel.h"
+#include <cstdint>
+#include <vector>
+
+// Карта, разрезанная на квадратные регионы со стороной region_size (от точки
+// 0,0). Каждый NPC принадлежит ровно одному региону - тому, где он стоял на
+// границе тика, - и двигается и атакует только там. NPC соседних регионов в
+// пределах дистанции атаки (призраки, halo) видны региону только как жертвы,
+// поэтому каждую пару находит ровно один регион.
+class WorldShards {
+private:
+    int requested_size;
+    int region_size;          // крупнее запрошенного, если регионов вышло бы больше точек
+    int cols = 0;
+    int rows = 0;
+    std::vector<uint32_t> region_start;   // CSR: индексы снимка по регионам
+    std::vector<uint32_t> owned_order;
+    std::vector<uint64_t> region_by_id;   // регион (строка, столбец) на прошлой границе по устойчивому id
+    size_t last_migrations = 0;
+    mutable WorkerPool workers;           // потоки регионов переживают тик
+
+    int column_of(int x) const;
+    int row_of(int y) const;
+
+public:
+    explicit WorldShards(int region_size = REGION_SIZE);
+
+    // Граница тика: раскладывает снимок по регионам. ids[i] - устойчивый номер
+    // записи i (например, индекс слота); по ним считаются переходы между регионами.
+    void assign(const CombatView& view, const std::vector<uint32_t>& ids = {});
+
+    int get_region_size() const { return region_size; }
+    size_t region_count() const { return static_cast<size_t>(cols) * rows; }
+    size_t owned_count(size_t region) const { return region_start[region + 1] - region_start[region]; }
+    const uint32_t* owned(size_t region) const { return owned_order.data() + region_start[region]; }
+    // NPC, сменившие регион при последнем assign
+    size_t migrations() const { return last_migrations; }
+    size_t worker_threads() const { return workers.size(); }
+
+    // body(region) для каждого региона; регион целиком обрабатывает один поток.
+    // Потоки постоянные и общие для всех вызовов этого WorldShards.
+    template <class Body>
+    void for_each_region(size_t thread_count, Body&& body) const {
+        workers.run(region_count(), thread_count, [&](size_t, size_t begin, size_t end) {
+            for (size_t region = begin; region < end; ++region) {
+                if (owned_count(region) > 0) body(region);
+            }
+        });
+    }
+
+    // Пары столкновений по всем регионам, упорядоченные по атакующему и жертве
+    // (тот же результат, что у Battle::find_collisions по всему снимку).
+    // kind - индекс, который строится внутри каждого региона.
+    void find_collisions(const Battle& battle, const CombatView& view,
+                         std::vector<CombatPair>& out, size_t thread_count,
+                         SpatialIndexKind kind = SpatialIndexKind::GRID) const;
+};
@@ -1,6 +1,9 @@
 #include "battle.h"
+#include "species.h"
 #include <algorithm>
 
+Battle::Battle() : policy(std::make_shared<SerialPolicy>()) {}
+
 void Battle::add_observer(std::shared_ptr<IObserver> observer) {
     std::lock_guard<std::mutex> lock(mutex);
     observers.push_back(observer);
@@ -25,39 +28,105 @@ void Battle::notify_observers(const std::shared_ptr<INpc>& killer, const std::sh
     }
 }
 
-void Battle::fight(std::vector<std::shared_ptr<INpc>>& npcs, int range) {
-    std::vector<std::pair<std::shared_ptr<INpc>, std::shared_ptr<INpc>>> kills;
+void Battle::set_policy(std::shared_ptr<const IExecutionPolicy> new_policy) {
+    policy = new_policy ? std::move(new_policy) : std::make_shared<SerialPolicy>();
+}
+
+template <class RangeOf>
+void Battle::collect_pairs(const CombatView& view, const ISpatialIndex& index, size_t attacker_count,
+                           RangeOf&& range_of, std::vector<CombatPair>& out,
+                           const IExecutionPolicy& run_policy) const {
+    // Атакующие делятся на непрерывные куски; списки склеиваются по порядку
+    // кусков, поэтому при упорядоченной политике результат как у одного потока
+    size_t total = std::min(attacker_count, view.size());
+    std::vector<std::vector<CombatPair>> chunk_pairs(run_policy.chunk_count(total));
+    bool ordered = run_policy.ordered();
 
-    for (size_t i = 0; i < npcs.size(); ++i) {
-        auto& attacker = npcs[i];
-        if (!attacker || !attacker->is_alive()) continue;
+    run_policy.run(total, [&](size_t chunk, size_t begin, size_t end) {
+        auto& local_pairs = chunk_pairs[chunk];
+        std::vector<uint32_t> candidates;
 
-        for (size_t j = 0; j < npcs.size(); ++j) {
-            if (i == j) continue;
+        for (size_t i = begin; i < end; ++i) {
+            if (!view.alive[i]) continue;
 
-            auto& defender = npcs[j];
-            if (!defender || !defender->is_alive()) continue;
+            const TypeMask& prey = prey_mask(view.types[i]);
+            if (prey.none()) continue;
 
-            double distance = attacker->get_position().distance_to(defender->get_position());
-            if (distance <= static_cast<double>(range)) {
-                auto visitor = std::make_shared<FightVisitor>(attacker->get_type());
-                if (defender->accept(visitor)) {
-                    kills.push_back({attacker, defender});
-                }
+            candidates.clear();
+            index.query_radius(view.position(i), range_of(i), candidates);
+            if (ordered) {
+                std::sort(candidates.begin(), candidates.end());
+            }
+
+            for (uint32_t j : candidates) {
+                if (i == j || !view.alive[j]) continue;
+                if (!prey[type_index(view.types[j])]) continue;
+                local_pairs.push_back({static_cast<uint32_t>(i), j});
             }
         }
+    });
+
+    out.clear();
+    for (auto& local_pairs : chunk_pairs) {
+        out.insert(out.end(), local_pairs.begin(), local_pairs.end());
     }
+}
 
-    for (auto& [killer, victim] : kills) {
-        if (victim && victim->is_alive()) {
-            victim->kill();
-            notify_observers(killer, victim);
-        }
+void Battle::find_fights(const CombatView& view, const ISpatialIndex& index, int range,
+                         std::vector<CombatPair>& out) const {
+    find_fights(view, index, range, out, *policy);
+}
+
+void Battle::find_fights(const CombatView& view, const ISpatialIndex& index, int range,
+                         std::vector<CombatPair>& out, const IExecutionPolicy& run_policy) const {
+    collect_pairs(view, index, view.size(), [range](size_t) { return range; }, out, run_policy);
+}
+
+void Battle::find_collisions(const CombatView& view, const ISpatialIndex& index,
+                             std::vector<CombatPair>& out) const {
+    find_collisions(view, index, view.size(), out, *policy);
+}
+
+void Battle::find_collisions(const CombatView& view, const ISpatialIndex& index, size_t attacker_count,
+                             std::vector<CombatPair>& out, const IExecutionPolicy& run_policy) const {
+    collect_pairs(view, index, attacker_count, [&view](size_t i) {
+        return species(view.types[i]).movement.kill_distance;
+    }, out, run_policy);
+}
+
+void Battle::resolve_duels(std::vector<Duel>& duels) const {
+    for (auto& duel : duels) {
+        BaseNpc* attacker = duel.attacker;
+        BaseNpc* defender = duel.defender;
+        if (!attacker || !defender || !attacker->is_alive() || !defender->is_alive()) continue;
+        if (!can_kill(attacker->get_type(), defender->get_type())) continue;
+
+        duel.fought = true;
+        duel.attack = attacker->roll_dice();
+        duel.defense = defender->roll_dice();
+        bool won = duel.attack > duel.defense;
+        duel.killed = won && defender->try_kill();
+        duel.lost_claim = won && !duel.killed;
     }
+}
+
+void Battle::fight(std::vector<std::shared_ptr<INpc>>& npcs, int range) {
+    CombatView view;
+    view.assign(npcs.begin(), npcs.end());
+
+    SpatialGrid grid(std::max(range, 1));
+    grid.build(view.positions);
+
+    std::vector<CombatPair> pairs;
+    find_fights(view, grid, range, pairs);
+
+    apply_kills(pairs, view,
+        [&](uint32_t, uint32_t victim) { return npcs[victim]->try_kill(); },
+        [&](uint32_t killer, uint32_t victim) { notify_observers(npcs[killer], npcs[victim]); });
 
     auto new_end = std::remove_if(npcs.begin(), npcs.end(),
         [](const std::shared_ptr<INpc>& npc) {
             return !npc || !npc->is_alive();
         });
     npcs.erase(new_end, npcs.end());
-}
\ No newline at end of file
+}
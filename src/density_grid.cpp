@@ -0,0 +1,109 @@
+#include "density_grid.h"
+#include <algorithm>
+
+void DensityGrid::reset(const GameConfig& world, size_t types, int max_side) {
+    bounds = world;
+    type_count = types;
+    int64_t side = std::max(world.width(), world.height());
+    int64_t limit = std::max(1, max_side);
+    cell_size = static_cast<int>(std::max<int64_t>(1, (side + limit - 1) / limit));
+    columns = static_cast<int>((world.width() + cell_size - 1) / cell_size);
+    rows = static_cast<int>((world.height() + cell_size - 1) / cell_size);
+    counts.assign(type_count * columns * rows, 0);
+    sums.assign(type_count * plane(), 0);
+    dirty_row.assign(type_count, rows);
+    cell_of.clear();
+    type_of.clear();
+    total = 0;
+}
+
+void DensityGrid::clear() {
+    std::fill(counts.begin(), counts.end(), 0);
+    std::fill(sums.begin(), sums.end(), 0);
+    std::fill(dirty_row.begin(), dirty_row.end(), rows);
+    cell_of.clear();
+    type_of.clear();
+    total = 0;
+}
+
+uint32_t DensityGrid::cell_at(const Position& pos) const {
+    if (!bounds.contains(pos.x, pos.y)) return OUTSIDE;
+    uint32_t column = static_cast<uint32_t>((static_cast<int64_t>(pos.x) - bounds.min_x) / cell_size);
+    uint32_t row = static_cast<uint32_t>((static_cast<int64_t>(pos.y) - bounds.min_y) / cell_size);
+    return row * static_cast<uint32_t>(columns) + column;
+}
+
+void DensityGrid::change(size_t type, uint32_t cell, int delta) {
+    if (cell == OUTSIDE || type >= type_count) return;
+    counts[type * columns * rows + cell] += delta;
+    int row = static_cast<int>(cell / static_cast<uint32_t>(columns));
+    dirty_row[type] = std::min(dirty_row[type], row);
+}
+
+void DensityGrid::update(uint32_t id, NpcType type, const Position& pos) {
+    if (id >= cell_of.size()) {
+        cell_of.resize(static_cast<size_t>(id) + 1, NONE);
+        type_of.resize(static_cast<size_t>(id) + 1, 0);
+    }
+    uint32_t cell = cell_at(pos);
+    uint16_t t = static_cast<uint16_t>(type);
+    uint32_t old_cell = cell_of[id];
+    if (old_cell == cell && type_of[id] == t) return;
+    if (old_cell == NONE) {
+        ++total;
+    } else {
+        change(type_of[id], old_cell, -1);
+    }
+    change(t, cell, 1);
+    cell_of[id] = cell;
+    type_of[id] = t;
+}
+
+void DensityGrid::erase(uint32_t id) {
+    if (!contains(id)) return;
+    change(type_of[id], cell_of[id], -1);
+    cell_of[id] = NONE;
+    --total;
+}
+
+// Суммы строки r зависят только от строк 0..r, поэтому строки выше
+// первой изменившейся остаются верными
+void DensityGrid::build_sums() {
+    size_t w = stride();
+    for (size_t t = 0; t < type_count; ++t) {
+        const uint32_t* c = counts.data() + t * columns * rows;
+        uint32_t* s = sums.data() + t * plane();
+        for (int row = dirty_row[t]; row < rows; ++row) {
+            uint32_t running = 0;
+            for (int column = 0; column < columns; ++column) {
+                running += c[static_cast<size_t>(row) * columns + column];
+                s[(row + 1) * w + column + 1] = s[row * w + column + 1] + running;
+            }
+        }
+        dirty_row[t] = rows;
+    }
+}
+
+uint64_t DensityGrid::count(const TypeMask& types, int min_x, int min_y, int max_x, int max_y) const {
+    uint64_t result = 0;
+    for (size_t t = 0; t < type_count; ++t) {
+        if (types[t]) {
+            result += count(static_cast<NpcType>(t), min_x, min_y, max_x, max_y);
+        }
+    }
+    return result;
+}
+
+bool DensityGrid::cell_range(int min_x, int min_y, int max_x, int max_y, int& c0, int& r0, int& c1, int& r1) const {
+    if (empty()) return false;
+    int64_t x0 = std::max<int64_t>(min_x, bounds.min_x);
+    int64_t y0 = std::max<int64_t>(min_y, bounds.min_y);
+    int64_t x1 = std::min<int64_t>(max_x, bounds.max_x);
+    int64_t y1 = std::min<int64_t>(max_y, bounds.max_y);
+    if (x0 > x1 || y0 > y1) return false;
+    c0 = static_cast<int>((x0 - bounds.min_x) / cell_size);
+    r0 = static_cast<int>((y0 - bounds.min_y) / cell_size);
+    c1 = static_cast<int>((x1 - bounds.min_x) / cell_size);
+    r1 = static_cast<int>((y1 - bounds.min_y) / cell_size);
+    return true;
+}
@@ -0,0 +1,108 @@
+#include "distance_kernel.h"
+#include <algorithm>
+#include <limits>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BALAGUR_AVX2_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Разность по оси бывает до 2^32 - 1 и в квадрате переполнила бы int64.
+// Всё, что дальше range, одинаково промах, поэтому разность прижимается к
+// range + 1 <= INT32_MAX: сумма двух квадратов помещается в int64, а младших
+// 32 бит со знаком хватает _mm256_mul_epi32. range не больше INT32_MAX - 1.
+int64_t axis_limit(int range) {
+    return static_cast<int64_t>(std::min(range, std::numeric_limits<int32_t>::max() - 1)) + 1;
+}
+
+}
+
+uint64_t range_hit_mask_scalar(const Position& center, const int32_t* xs, const int32_t* ys, size_t count, int range) {
+    if (range < 0) return 0;
+    int64_t limit = axis_limit(range);
+    int64_t range_sq = (limit - 1) * (limit - 1);
+
+    uint64_t mask = 0;
+    for (size_t i = 0; i < count; ++i) {
+        int64_t dx = std::clamp<int64_t>(static_cast<int64_t>(xs[i]) - center.x, -limit, limit);
+        int64_t dy = std::clamp<int64_t>(static_cast<int64_t>(ys[i]) - center.y, -limit, limit);
+        mask |= static_cast<uint64_t>(dx * dx + dy * dy <= range_sq) << i;
+    }
+    return mask;
+}
+
+#ifdef BALAGUR_AVX2_DISPATCH
+
+namespace {
+
+// Прижимает 64-битные дорожки к [-limit, limit]
+__attribute__((target("avx2")))
+__m256i clamp_axis(__m256i d, __m256i high, __m256i low) {
+    d = _mm256_blendv_epi8(d, high, _mm256_cmpgt_epi64(d, high));
+    return _mm256_blendv_epi8(d, low, _mm256_cmpgt_epi64(low, d));
+}
+
+// Четыре кандидата за шаг: разности в 64-битных дорожках, прижатые как в
+// скалярной версии, поэтому _mm256_mul_epi32 по младшим 32 битам точен
+__attribute__((target("avx2")))
+uint64_t range_hit_mask_avx2(const Position& center, const int32_t* xs, const int32_t* ys, size_t count, int range) {
+    if (range < 0) return 0;
+
+    const int64_t axis = axis_limit(range);
+    const __m256i cx = _mm256_set1_epi64x(center.x);
+    const __m256i cy = _mm256_set1_epi64x(center.y);
+    const __m256i high = _mm256_set1_epi64x(axis);
+    const __m256i low = _mm256_set1_epi64x(-axis);
+    // d <= r^2  <=>  r^2 + 1 > d
+    const __m256i limit = _mm256_set1_epi64x((axis - 1) * (axis - 1) + 1);
+
+    uint64_t mask = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i x = _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(xs + i)));
+        __m256i y = _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ys + i)));
+        __m256i dx = clamp_axis(_mm256_sub_epi64(x, cx), high, low);
+        __m256i dy = clamp_axis(_mm256_sub_epi64(y, cy), high, low);
+        __m256i dist = _mm256_add_epi64(_mm256_mul_epi32(dx, dx), _mm256_mul_epi32(dy, dy));
+        __m256i hit = _mm256_cmpgt_epi64(limit, dist);
+        auto bits = static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(hit)));
+        mask |= bits << i;
+    }
+    if (i < count) {
+        mask |= range_hit_mask_scalar(center, xs + i, ys + i, count - i, range) << i;
+    }
+    return mask;
+}
+
+using RangeKernel = uint64_t (*)(const Position&, const int32_t*, const int32_t*, size_t, int);
+
+RangeKernel select_kernel() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? range_hit_mask_avx2 : range_hit_mask_scalar;
+}
+
+const RangeKernel range_kernel = select_kernel();
+
+}
+
+uint64_t range_hit_mask(const Position& center, const int32_t* xs, const int32_t* ys, size_t count, int range) {
+    return range_kernel(center, xs, ys, count, range);
+}
+
+bool distance_kernel_uses_avx2() {
+    return range_kernel != range_hit_mask_scalar;
+}
+
+#else
+
+uint64_t range_hit_mask(const Position& center, const int32_t* xs, const int32_t* ys, size_t count, int range) {
+    return range_hit_mask_scalar(center, xs, ys, count, range);
+}
+
+bool distance_kernel_uses_avx2() {
+    return false;
+}
+
+#endif
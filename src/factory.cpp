@@ -1,9 +1,256 @@
 #include "factory.h"
+#include "parallel.h"
 #include <stdexcept>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <random>
 
-std::shared_ptr<INpc> NpcFactory::create_npc(NpcType type, const std::string& base_name, int x, int y) {
+namespace {
+
+const uint32_t MAX_RESERVED_ORDINAL = 999999999;   // имя с большим номером не прочитается обратно
+
+// Блок номеров основы, взятый потоком у общего счётчика
+struct OrdinalBlock {
+    uint32_t next = 1;
+    uint32_t last = 0;
+    bool plain_taken = false;   // имя без номера уже занято
+    std::vector<uint32_t> recycled;   // освобождённые номера, взятые из общего списка
+};
+
+// Блоки потока относятся к одному поколению одного генератора
+struct ThreadBlocks {
+    uint64_t owner = 0;
+    std::unordered_map<uint32_t, OrdinalBlock> blocks;
+};
+
+thread_local ThreadBlocks thread_blocks;
+std::atomic<uint64_t> next_generation{1};
+
+bool ends_with_digit(std::string_view str) {
+    return !str.empty() && str.back() >= '0' && str.back() <= '9';
+}
+
+// Полоса пулов потока: по кругу, чтобы потоки расходились по полосам равномерно
+size_t thread_stripe() {
+    static std::atomic<size_t> next_stripe{0};
+    thread_local size_t stripe = next_stripe.fetch_add(1) % NpcFactory::POOL_STRIPES;
+    return stripe;
+}
+
+}
+
+NameGenerator::NameGenerator() : generation(next_generation.fetch_add(1)) {}
+
+bool NameGenerator::insert(const NameId& name) {
+    NameShard& shard = shard_of(name.key());
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.used.insert(name.key()).second;
+}
+
+NameGenerator::BaseState& NameGenerator::state_of(uint32_t base) {
+    BaseShard& shard = bases[base % BASE_SHARDS];
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.states.find(base);
+        if (it != shard.states.end()) return *it->second;
+    }
+    std::lock_guard<std::shared_mutex> lock(shard.mutex);
+    auto& state = shard.states[base];
+    if (!state) {
+        state = std::make_unique<BaseState>();
+    }
+    return *state;
+}
+
+// Проверка резерва и вставка - под одним разделяемым замком основы, поэтому
+// reserve_names не может занять диапазон между ними
+bool NameGenerator::try_take(const NameId& name) {
+    BaseState& state = state_of(name.base);
+    std::shared_lock<std::shared_mutex> lock(bases[name.base % BASE_SHARDS].mutex);
+    for (const auto& range : state.reserved) {
+        if (name.ordinal >= range.first && name.ordinal <= range.second) return false;
+    }
+    if (!insert(name)) return false;
+    uint32_t highest = state.highest.load();
+    while (highest < name.ordinal && !state.highest.compare_exchange_weak(highest, name.ordinal)) {
+    }
+    return true;
+}
+
+NameId NameGenerator::reserve_names(std::string_view base_name, uint32_t count) {
+    if (ends_with_digit(base_name)) {
+        throw std::invalid_argument("Reserved name base must not end with a digit");
+    }
+    uint32_t base = NameTable::instance().intern(base_name);
+    BaseState& state = state_of(base);
+    std::lock_guard<std::shared_mutex> lock(bases[base % BASE_SHARDS].mutex);
+
+    // CAS, а не запись: потоки берут блоки у того же счётчика без этого замка
+    uint32_t current = state.next_ordinal.load();
+    uint32_t first;
+    do {
+        first = std::max({current, state.highest.load() + 1, 1u});
+        if (count == 0) return {base, first};
+        if (first > MAX_RESERVED_ORDINAL || count > MAX_RESERVED_ORDINAL - first + 1) {
+            throw std::length_error("Too many names reserved for " + std::string(base_name));
+        }
+    } while (!state.next_ordinal.compare_exchange_weak(current, first + count));
+    state.reserved.push_back({first, first + count - 1});
+    return {base, first};
+}
+
+NameId NameGenerator::generate_unique_name(std::string_view base_name) {
+    auto& table = NameTable::instance();
+    if (ends_with_digit(base_name) || base_name.empty()) {
+        NameId name = table.make_name(base_name);
+        if (try_take(name)) {
+            return name;
+        }
+        std::string candidate;
+        for (int counter = 1;; ++counter) {
+            candidate.assign(base_name);
+            candidate += std::to_string(counter);
+            name = table.make_name(candidate);
+            if (try_take(name)) {
+                return name;
+            }
+        }
+    }
+
+    // Основа без числового хвоста: "Frog" + k это просто {Frog, k}, строки не
+    // собираем, номера берём из блока потока
+    uint32_t base = table.intern(base_name);
+    uint64_t current = generation.load(std::memory_order_relaxed);
+    if (thread_blocks.owner != current) {
+        thread_blocks.blocks.clear();
+        thread_blocks.owner = current;
+    }
+    OrdinalBlock& block = thread_blocks.blocks[base];
+    if (!block.plain_taken) {
+        block.plain_taken = true;
+        if (insert({base, 0})) {
+            return {base, 0};
+        }
+    }
+    // Номера из блока никогда не попадают в резерв: счётчик уже прошёл его.
+    // Занятые явными именами пропускаются.
+    while (true) {
+        if (!block.recycled.empty()) {
+            NameId name{base, block.recycled.back()};
+            block.recycled.pop_back();
+            if (insert(name)) {
+                return name;
+            }
+            continue;
+        }
+        if (block.next > block.last) {
+            BaseState& state = state_of(base);
+            {
+                std::lock_guard<std::mutex> lock(state.free_mutex);
+                size_t take = std::min<size_t>(state.free_ordinals.size(), ORDINAL_BLOCK);
+                block.recycled.assign(state.free_ordinals.end() - take, state.free_ordinals.end());
+                state.free_ordinals.resize(state.free_ordinals.size() - take);
+            }
+            if (!block.recycled.empty()) {
+                continue;
+            }
+            uint32_t first = state.next_ordinal.fetch_add(ORDINAL_BLOCK);
+            block.next = first;
+            block.last = first + ORDINAL_BLOCK - 1;
+        }
+        NameId name{base, block.next++};
+        if (insert(name)) {
+            return name;
+        }
+    }
+}
+
+// Номер уходит в общий список основы; основы с цифрой на конце номера из
+// блоков не берут, их имена только снимаются с учёта
+void NameGenerator::release(const NameId& name) {
+    NameShard& shard = shard_of(name.key());
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.used.erase(name.key());
+    }
+    if (ends_with_digit(NameTable::instance().view(name.base))) return;
+    BaseState& state = state_of(name.base);
+    std::lock_guard<std::mutex> lock(state.free_mutex);
+    state.free_ordinals.push_back(name.ordinal);
+}
+
+void NameGenerator::clear() {
+    generation = next_generation.fetch_add(1);
+    for (auto& shard : names) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.used.clear();
+    }
+    for (auto& shard : bases) {
+        std::lock_guard<std::shared_mutex> lock(shard.mutex);
+        shard.states.clear();
+    }
+}
+
+NpcFactory::NpcFactory()
+    : pools(MAX_TYPES * POOL_STRIPES), pool_ready(new std::atomic<bool>[MAX_TYPES * POOL_STRIPES]()) {}
+
+// Пул создаётся один раз под замком; дальше поток читает его без замков
+const std::shared_ptr<NpcPool>& NpcFactory::pool_for(NpcType type) {
+    size_t index = type_index(type) * POOL_STRIPES + thread_stripe();
+    if (!pool_ready[index].load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(pools_mutex);
+        if (!pools[index]) {
+            pools[index] = std::make_shared<NpcPool>();
+        }
+        pool_ready[index].store(true, std::memory_order_release);
+    }
+    return pools[index];
+}
+
+NpcFactory::NpcFactory(const GameConfig& config) : NpcFactory() {
+    this->config = config;
+}
+
+PoolStats NpcFactory::get_pool_stats() const {
+    std::lock_guard<std::mutex> lock(pools_mutex);
+    PoolStats total;
+    for (const auto& pool : pools) {
+        if (pool) {
+            total += pool->get_stats();
+        }
+    }
+    for (const auto& pool : worker_pools) {
+        total += pool->get_stats();
+    }
+    return total;
+}
+
+PoolStats NpcFactory::get_pool_stats(NpcType type) const {
+    std::lock_guard<std::mutex> lock(pools_mutex);
+    PoolStats total;
+    for (size_t stripe = 0; stripe < POOL_STRIPES; ++stripe) {
+        const auto& pool = pools[type_index(type) * POOL_STRIPES + stripe];
+        if (pool) {
+            total += pool->get_stats();
+        }
+    }
+    return total;
+}
+
+void NpcFactory::release_pools() {
+    std::lock_guard<std::mutex> lock(pools_mutex);
+    for (auto& pool : pools) {
+        if (pool) {
+            pool->release();
+        }
+    }
+    for (auto& pool : worker_pools) {
+        pool->release();
+    }
+}
+
+std::shared_ptr<BaseNpc> NpcFactory::create_npc(NpcType type, std::string_view base_name, int x, int y) {
     if (x < config.min_x || x > config.max_x || 
         y < config.min_y || y > config.max_y) {
         throw std::out_of_range("Coordinates must be in range [" + 
@@ -13,30 +260,136 @@ std::shared_ptr<INpc> NpcFactory::create_npc(NpcType type, const std::string& ba
                                std::to_string(config.max_y) + "] for y");
     }
     
+    if (!SpeciesRegistry::instance().contains(type)) {
+        throw std::invalid_argument("Unknown NPC type " + std::to_string(type_index(type)));
+    }
+    
     auto unique_name = name_generator.generate_unique_name(base_name);
     
     switch (type) {
-        case NpcType::DRAGON: return std::make_shared<Dragon>(unique_name, x, y);
-        case NpcType::FROG: return std::make_shared<Frog>(unique_name, x, y);
-        case NpcType::BULL: return std::make_shared<Bull>(unique_name, x, y);
-        default: return nullptr;
+        case NpcType::DRAGON: return make_pooled<Dragon>(type, unique_name, x, y);
+        case NpcType::FROG: return make_pooled<Frog>(type, unique_name, x, y);
+        case NpcType::BULL: return make_pooled<Bull>(type, unique_name, x, y);
+        default: return make_pooled<BaseNpc>(type, type, unique_name, x, y);
     }
 }
 
-std::shared_ptr<INpc> NpcFactory::create_npc_from_stream(std::istream& in) {
+std::vector<std::shared_ptr<BaseNpc>> NpcFactory::generate_world(size_t count, const GameConfig& bounds, uint32_t seed,
+                                                                 size_t thread_count) {
+    if (bounds.width() <= 0 || bounds.height() <= 0) {
+        throw std::invalid_argument("World bounds must not be empty");
+    }
+    const auto& registry = SpeciesRegistry::instance();
+    size_t species_count = registry.size();
+    size_t blocks = (count + WORLD_BLOCK_SIZE - 1) / WORLD_BLOCK_SIZE;
+    thread_count = std::max<size_t>(1, std::min(thread_count, blocks));
+    auto block_range = [&](size_t block, size_t& begin, size_t& end) {
+        begin = block * WORLD_BLOCK_SIZE;
+        end = std::min(count, begin + WORLD_BLOCK_SIZE);
+    };
+
+    // Проход 1: виды, координаты и зёрна NPC; счёт видов по блокам
+    std::vector<NpcType> types(count);
+    std::vector<Position> positions(count);
+    std::vector<uint32_t> seeds(count);
+    std::vector<uint32_t> block_counts(blocks * species_count, 0);
+    parallel_for_chunks(blocks, thread_count, [&](size_t, size_t first_block, size_t last_block) {
+        std::uniform_int_distribution<int> type_dist(0, static_cast<int>(species_count) - 1);
+        std::uniform_int_distribution<int> x_dist(bounds.min_x, bounds.max_x);
+        std::uniform_int_distribution<int> y_dist(bounds.min_y, bounds.max_y);
+        for (size_t block = first_block; block < last_block; ++block) {
+            std::seed_seq block_seed{seed, static_cast<uint32_t>(block)};
+            std::mt19937 gen(block_seed);
+            size_t begin, end;
+            block_range(block, begin, end);
+            for (size_t i = begin; i < end; ++i) {
+                types[i] = static_cast<NpcType>(type_dist(gen));
+                positions[i] = {x_dist(gen), y_dist(gen)};
+                seeds[i] = static_cast<uint32_t>(gen());
+                ++block_counts[block * species_count + type_index(types[i])];
+            }
+        }
+    });
+
+    // Номера имён вида идут подряд в порядке блоков: block_counts становится
+    // первым номером вида в блоке
+    std::vector<uint32_t> totals(species_count, 0);
+    for (size_t block = 0; block < blocks; ++block) {
+        for (size_t t = 0; t < species_count; ++t) {
+            totals[t] += block_counts[block * species_count + t];
+        }
+    }
+    std::vector<NameId> first_names(species_count);
+    for (size_t t = 0; t < species_count; ++t) {
+        first_names[t] = name_generator.reserve_names(species(static_cast<NpcType>(t)).display_name, totals[t]);
+    }
+    std::vector<uint32_t> next(species_count);
+    for (size_t t = 0; t < species_count; ++t) {
+        next[t] = first_names[t].ordinal;
+    }
+    for (size_t block = 0; block < blocks; ++block) {
+        for (size_t t = 0; t < species_count; ++t) {
+            uint32_t& in_block = block_counts[block * species_count + t];
+            uint32_t first = next[t];
+            next[t] += in_block;
+            in_block = first;
+        }
+    }
+
+    // Проход 2: NPC в заранее выделенном массиве, каждый поток - из своего пула
+    std::vector<std::shared_ptr<NpcPool>> chunk_pools;
+    {
+        std::lock_guard<std::mutex> lock(pools_mutex);
+        while (worker_pools.size() < thread_count) {
+            worker_pools.push_back(std::make_shared<NpcPool>(WORLD_BLOCK_SIZE));
+        }
+        chunk_pools.assign(worker_pools.begin(), worker_pools.begin() + thread_count);
+    }
+    std::vector<std::shared_ptr<BaseNpc>> world(count);
+    parallel_for_chunks(blocks, thread_count, [&](size_t chunk, size_t first_block, size_t last_block) {
+        const std::shared_ptr<NpcPool>& pool = chunk_pools[chunk];
+        for (size_t block = first_block; block < last_block; ++block) {
+            uint32_t* ordinals = block_counts.data() + block * species_count;
+            size_t begin, end;
+            block_range(block, begin, end);
+            for (size_t i = begin; i < end; ++i) {
+                size_t t = type_index(types[i]);
+                NameId name{first_names[t].base, ordinals[t]++};
+                int x = positions[i].x;
+                int y = positions[i].y;
+                switch (types[i]) {
+                    case NpcType::DRAGON: world[i] = make_in<Dragon>(pool, name, x, y, seeds[i]); break;
+                    case NpcType::FROG: world[i] = make_in<Frog>(pool, name, x, y, seeds[i]); break;
+                    case NpcType::BULL: world[i] = make_in<Bull>(pool, name, x, y, seeds[i]); break;
+                    default: world[i] = make_in<BaseNpc>(pool, types[i], name, x, y, seeds[i]); break;
+                }
+            }
+        }
+    });
+    return world;
+}
+
+std::shared_ptr<BaseNpc> NpcFactory::create_npc_from_stream(std::istream& in) {
     std::string type_str;
     if (!(in >> type_str)) {
         return nullptr;
     }
     
-    if (type_str == "dragon") return std::make_shared<Dragon>(in);
-    else if (type_str == "frog") return std::make_shared<Frog>(in);
-    else if (type_str == "bull") return std::make_shared<Bull>(in);
-    else return nullptr;
+    NpcType type;
+    if (!species_from_name(type_str, type)) {
+        return nullptr;
+    }
+    
+    switch (type) {
+        case NpcType::DRAGON: return make_pooled<Dragon>(type, in);
+        case NpcType::FROG: return make_pooled<Frog>(type, in);
+        case NpcType::BULL: return make_pooled<Bull>(type, in);
+        default: return make_pooled<BaseNpc>(type, type, in);
+    }
 }
 
-std::vector<std::shared_ptr<INpc>> NpcFactory::load_from_file(const std::string& filename) {
-    std::vector<std::shared_ptr<INpc>> npcs;
+std::vector<std::shared_ptr<BaseNpc>> NpcFactory::load_from_file(const std::string& filename) {
+    std::vector<std::shared_ptr<BaseNpc>> npcs;
     std::ifstream file(filename);
     
     if (!file.is_open()) {
@@ -58,7 +411,10 @@ std::vector<std::shared_ptr<INpc>> NpcFactory::load_from_file(const std::string&
     return npcs;
 }
 
-void NpcFactory::save_to_file(const std::string& filename, const std::vector<std::shared_ptr<INpc>>& npcs) {
+namespace {
+
+template <class Npc>
+void write_npcs(const std::string& filename, const std::vector<std::shared_ptr<Npc>>& npcs) {
     std::ofstream file(filename);
     if (!file.is_open()) {
         throw std::runtime_error("Cannot open file for writing: " + filename);
@@ -79,4 +435,14 @@ void NpcFactory::save_to_file(const std::string& filename, const std::vector<std
             file << "\n";
         }
     }
-}
\ No newline at end of file
+}
+
+}
+
+void NpcFactory::save_to_file(const std::string& filename, const std::vector<std::shared_ptr<INpc>>& npcs) {
+    write_npcs(filename, npcs);
+}
+
+void NpcFactory::save_to_file(const std::string& filename, const std::vector<std::shared_ptr<BaseNpc>>& npcs) {
+    write_npcs(filename, npcs);
+}
@@ -1,32 +1,109 @@
 #include "game.h"
 #include "constants.h"
+#include "species.h"
+#include "spatial_index.h"
+#include "parallel.h"
+#include "morton.h"
+#include "phase_profiler.h"
 #include <iostream>
 #include <chrono>
 #include <random>
 #include <iomanip>
+#include <sstream>
 #include <algorithm>
+#include <stdexcept>
+#include <string>
 
 using namespace std::chrono_literals;
 
-Game::Game() : game_start_time(std::chrono::steady_clock::now()) {
-    GameConfig editor_config = {0, EDITOR_MAX_X, 0, EDITOR_MAX_Y};
-    factory.set_config(editor_config);
+namespace {
+
+const uint32_t NO_SLOT = UINT32_MAX;
+const size_t MAP_BOX_TEXT = 49;   // текст строки рамки карты между "| " и "|"
+
+// Строка рамки карты шириной 52; длинный текст переносится после ", ",
+// продолжение - с отступом
+void push_boxed(std::vector<std::string>& lines, std::string text) {
+    while (text.size() > MAP_BOX_TEXT) {
+        size_t cut = text.rfind(", ", MAP_BOX_TEXT - 1);
+        size_t keep = cut == std::string::npos || cut == 0 ? MAP_BOX_TEXT : cut + 1;
+        std::string line = text.substr(0, keep);
+        line.resize(MAP_BOX_TEXT, ' ');
+        lines.push_back("| " + line + "|");
+        text = "  " + text.substr(text[keep] == ' ' ? keep + 1 : keep);
+    }
+    text.resize(MAP_BOX_TEXT, ' ');
+    lines.push_back("| " + text + "|");
+}
+
+// Индекс хранит NPC по номеру слота, а боевому движку нужны индексы снимка.
+// Слоты, которых нет в снимке (добавлены после него), пропускаются.
+class SnapshotTreeIndex : public ISpatialIndex {
+private:
+    const TypedIndex& index;
+    const std::vector<uint32_t>& dense_of_slot;
+    TypeMask all_types = TypeMask().set();
+
+    void to_dense(std::vector<uint32_t>& out, size_t from) const {
+        size_t write = from;
+        for (size_t k = from; k < out.size(); ++k) {
+            uint32_t slot = out[k];
+            if (slot < dense_of_slot.size() && dense_of_slot[slot] != NO_SLOT) {
+                out[write++] = dense_of_slot[slot];
+            }
+        }
+        out.resize(write);
+    }
+
+public:
+    SnapshotTreeIndex(const TypedIndex& index, const std::vector<uint32_t>& dense_of_slot)
+        : index(index), dense_of_slot(dense_of_slot) {}
+
+    void build(const PositionBlock&) override {}
+    void query_radius(const Position& center, int range, std::vector<uint32_t>& out) const override {
+        size_t from = out.size();
+        index.query_radius(center, range, all_types, out);
+        to_dense(out, from);
+    }
+    void query_rect(int min_x, int min_y, int max_x, int max_y, std::vector<uint32_t>& out) const override {
+        size_t from = out.size();
+        index.query_rect(min_x, min_y, max_x, max_y, all_types, out);
+        to_dense(out, from);
+    }
+};
+
+}
+
+Game::Game(const GameConfig& world_bounds, const GameConfig& editor_bounds)
+    : world_bounds(world_bounds), editor_bounds(editor_bounds),
+      game_start_time(std::chrono::steady_clock::now()), respawn_rng(std::random_device{}()) {
+    if (world_bounds.width() <= 0 || world_bounds.height() <= 0 ||
+        editor_bounds.width() <= 0 || editor_bounds.height() <= 0) {
+        throw std::invalid_argument("World bounds must not be empty");
+    }
+    factory.set_config(editor_bounds);
     
     console_observer = std::make_shared<ConsoleObserver>();
     file_observer = std::make_shared<FileObserver>("battle_log.txt");
 }
 
 Game::~Game() {
+    stop_live_map();
     reset_game();  
 }
 
 void Game::reset_game() {
     stop();
     
+    std::vector<std::shared_ptr<BaseNpc>> removed;
     {
         std::lock_guard<std::shared_mutex> lock(npcs_mutex);
+        removed.assign(npcs.begin(), npcs.end());
         npcs.clear();
     }
+    graveyard.bury(removed);   // снимок живой карты мог их ещё держать
+    index_stale = true;
+    density_stale = true;
     
     {
         std::lock_guard<std::mutex> lock(battle_queue_mutex);
@@ -35,7 +112,12 @@ void Game::reset_game() {
         }
     }
     
-    factory.clear_names();
+    {
+        std::lock_guard<std::shared_mutex> lock(factory_mutex);
+        factory.clear_names();
+        factory.release_pools();
+    }
+    freed_names.clear();   // имена прошлой игры: в новом реестре они могут быть заняты
     game_running = false;
     game_start_time = std::chrono::steady_clock::now();
     
@@ -50,260 +132,701 @@ void Game::reset_game() {
     std::cout << "Game reset completed\n";
 }
 
-void Game::add_npc(NpcType type, const std::string& base_name, int x, int y) {
+NpcHandle Game::add_npc(NpcType type, const std::string& base_name, int x, int y) {
     try {
-        auto npc = factory.create_npc(type, base_name, x, y);
+        std::shared_ptr<BaseNpc> npc;
+        {
+            std::shared_lock<std::shared_mutex> lock(factory_mutex);
+            npc = factory.create_npc(type, base_name, x, y);
+        }
         if (npc) {
-            std::lock_guard<std::shared_mutex> lock(npcs_mutex);
-            npc->subscribe(console_observer);
-            npc->subscribe(file_observer);
-            npcs.push_back(npc);
+            // Эксклюзивно - только вставка; NPC появится у регионов со следующего тика
+            NpcHandle handle;
+            {
+                std::lock_guard<std::shared_mutex> lock(npcs_mutex);
+                handle = npcs.insert(npc);
+            }
+            index_stale = true;
+            density_stale = true;
             
             std::lock_guard<std::mutex> lock_cout(cout_mutex);
-            std::cout << "Added NPC: " << npc->info() << "\n";
+            std::cout << "Added NPC: ";
+            npc->print_info(std::cout);
+            std::cout << "\n";
+            return handle;
         }
     } catch (const std::exception& e) {
         std::lock_guard<std::mutex> lock(cout_mutex);
         std::cout << "Error: " << e.what() << "\n";
     }
+    return NpcHandle();
+}
+
+AddNpcsSummary Game::add_npcs(const NpcSpec* specs, size_t count) {
+    AddNpcsSummary summary;
+    summary.requested = count;
+    summary.handles.assign(count, NpcHandle());
+    
+    // Проверка до создания: фабрика бросала бы исключение на каждом неверном.
+    // Границы - те, что проверит фабрика (initialize_game ставит ей границы
+    // мира); под разделяемым factory_mutex они не меняются.
+    const auto& registry = SpeciesRegistry::instance();
+    std::vector<std::shared_ptr<BaseNpc>> created(count);
+    {
+        std::shared_lock<std::shared_mutex> lock(factory_mutex);
+        GameConfig bounds = factory.get_config();
+        for (size_t i = 0; i < count; ++i) {
+            if (!registry.contains(specs[i].type)) {
+                ++summary.unknown_type;
+            } else if (!bounds.contains(specs[i].x, specs[i].y)) {
+                ++summary.out_of_bounds;
+            } else {
+                // Отказ фабрики по другой причине не прерывает пакет: созданные раньше
+                // всё равно вставляются
+                try {
+                    created[i] = factory.create_npc(specs[i].type, specs[i].base_name, specs[i].x, specs[i].y);
+                } catch (const std::exception&) {
+                    ++summary.failed;
+                }
+            }
+        }
+    }
+    
+    {
+        std::lock_guard<std::shared_mutex> lock(npcs_mutex);
+        npcs.reserve(npcs.size() + count - summary.unknown_type - summary.out_of_bounds - summary.failed);
+        for (size_t i = 0; i < count; ++i) {
+            if (created[i]) {
+                summary.handles[i] = npcs.insert(std::move(created[i]));
+                ++summary.added;
+            }
+        }
+    }
+    if (summary.added > 0) {
+        index_stale = true;
+        density_stale = true;
+    }
+    return summary;
 }
 
 void Game::load_from_file(const std::string& filename) {
     reset_game(); 
-    auto loaded = factory.load_from_file(filename);
+    std::vector<std::shared_ptr<BaseNpc>> loaded;
+    {
+        std::shared_lock<std::shared_mutex> lock(factory_mutex);
+        loaded = factory.load_from_file(filename);
+    }
     
-    std::lock_guard<std::shared_mutex> lock(npcs_mutex);
-    for (auto& npc : loaded) {
-        if (npc) {
-            npc->subscribe(console_observer);
-            npc->subscribe(file_observer);
-            npcs.push_back(npc);
+    {
+        std::lock_guard<std::shared_mutex> lock(npcs_mutex);
+        npcs.reserve(loaded.size());
+        for (auto& npc : loaded) {
+            if (npc) {
+                npcs.insert(npc);
+            }
         }
     }
+    index_stale = true;
+    density_stale = true;
     
     std::lock_guard<std::mutex> lock_cout(cout_mutex);
     std::cout << "Loaded " << loaded.size() << " NPCs from " << filename << "\n";
 }
 
 void Game::save_to_file(const std::string& filename) {
-    std::shared_lock<std::shared_mutex> lock(npcs_mutex);
-    factory.save_to_file(filename, npcs);
+    std::vector<std::shared_ptr<BaseNpc>> saved;
+    {
+        std::shared_lock<std::shared_mutex> lock(npcs_mutex);
+        saved.assign(npcs.begin(), npcs.end());
+    }
+    factory.save_to_file(filename, saved);
     
     std::lock_guard<std::mutex> lock_cout(cout_mutex);
-    std::cout << "Saved " << npcs.size() << " NPCs to " << filename << "\n";
+    std::cout << "Saved " << saved.size() << " NPCs to " << filename << "\n";
 }
 
 void Game::print_npcs() {
-    std::shared_lock<std::shared_mutex> lock(npcs_mutex);
+    NpcSnapshot snapshot;
+    take_snapshot(snapshot);
     
     std::lock_guard<std::mutex> lock_cout(cout_mutex);
-    std::cout << "\n=== NPC List (" << npcs.size() << ") ===\n";
-    for (size_t i = 0; i < npcs.size(); ++i) {
-        if (npcs[i]) {
-            std::cout << i + 1 << ". " << npcs[i]->info() << "\n";
+    std::cout << "\n=== NPC List (" << snapshot.size() << ") ===\n";
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        if (snapshot.npcs[i]) {
+            std::cout << i + 1 << ". ";
+            snapshot.npcs[i]->print_info(std::cout);
+            std::cout << "\n";
         }
     }
     std::cout << "=====================\n";
 }
 
 void Game::fight(int range) {
-    std::shared_lock<std::shared_mutex> lock(npcs_mutex);
+    fight(range, default_thread_count());
+}
+
+void Game::fight(int range, size_t thread_count) {
+    NpcSnapshot snapshot;
+    take_snapshot(snapshot);
     
-    std::vector<std::pair<std::shared_ptr<INpc>, std::shared_ptr<INpc>>> kills;
+    CombatView view;
+    view.assign(snapshot.npcs.begin(), snapshot.npcs.end());
+    auto index = make_spatial_index(index_kind, std::max(range, 1));
+    index->build(view.positions);
     
-    for (size_t i = 0; i < npcs.size(); ++i) {
-        auto& attacker = npcs[i];
-        if (!attacker || !attacker->is_alive()) continue;
-        
-        for (size_t j = 0; j < npcs.size(); ++j) {
-            if (i == j) continue;
-            
-            auto& defender = npcs[j];
-            if (!defender || !defender->is_alive()) continue;
-            
-            double distance = attacker->get_position().distance_to(defender->get_position());
-            if (distance <= range) {
-                auto visitor = std::make_shared<FightVisitor>(attacker->get_type());
-                if (defender->accept(visitor)) {
-                    kills.push_back({attacker, defender});
-                }
-            }
-        }
-    }
+    std::vector<CombatPair> pairs;
+    DeterministicPolicy policy(std::max<size_t>(1, thread_count), MIN_NPCS_PER_THREAD);
+    battle.find_fights(view, *index, range, pairs, policy);
     
-    for (auto& [killer, victim] : kills) {
-        if (victim->is_alive()) {
-            victim->kill();
-            killer->notify_kill(victim);
-        }
-    }
+    // battle_worker может убивать одновременно: смерть достаётся тому,
+    // чей CAS прошёл первым
+    battle.apply_kills(pairs, view,
+        [&](uint32_t, uint32_t victim) { return snapshot.npcs[victim]->try_kill(); },
+        [&](uint32_t killer, uint32_t victim) {
+            notify_kill(*snapshot.npcs[killer], snapshot.handles[killer],
+                        *snapshot.npcs[victim], snapshot.handles[victim]);
+        },
+        policy);
     
     cleanup_dead_npcs();
     
     std::lock_guard<std::mutex> lock_cout(cout_mutex);
-    std::cout << "Battle finished. " << kills.size() << " fights occurred.\n";
+    std::cout << "Battle finished. " << pairs.size() << " fights occurred.\n";
 }
 
 void Game::initialize_game(int npc_count) {
+    std::random_device rd;
+    initialize_game(npc_count, rd());
+}
+
+// Мир строится параллельно вне npcs_mutex и публикуется одной вставкой под
+// замком: читатели видят либо пустое хранилище, либо весь мир
+void Game::initialize_game(int npc_count, uint32_t seed) {
     reset_game();  
     
-    GameConfig game_config = {0, MAP_WIDTH - 1, 0, MAP_HEIGHT - 1};
-    factory.set_config(game_config);
-    
-    std::lock_guard<std::shared_mutex> lock(npcs_mutex);
-    
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<int> type_dist(0, 2);
-    std::uniform_int_distribution<int> coord_dist(0, MAP_WIDTH - 1);
+    std::vector<std::shared_ptr<BaseNpc>> created;
+    {
+        std::lock_guard<std::shared_mutex> lock(factory_mutex);
+        factory.set_config(world_bounds);
+        created = factory.generate_world(static_cast<size_t>(std::max(npc_count, 0)), world_bounds, seed,
+                                         default_thread_count());
+    }
     
-    for (int i = 0; i < npc_count; ++i) {
-        NpcType type = static_cast<NpcType>(type_dist(gen));
-        std::string base_name;
-        
-        switch(type) {
-            case NpcType::DRAGON: base_name = "Dragon"; break;
-            case NpcType::FROG: base_name = "Frog"; break;
-            case NpcType::BULL: base_name = "Bull"; break;
-            default: continue;
+    size_t total;
+    {
+        std::lock_guard<std::shared_mutex> lock(npcs_mutex);
+        npcs.reserve(created.size());
+        for (auto& npc : created) {
+            npcs.insert(std::move(npc));
         }
-        
-        int x = coord_dist(gen);
-        int y = coord_dist(gen);
-        
-        try {
-            auto npc = factory.create_npc(type, base_name, x, y);
-            if (npc) {
-                npc->subscribe(console_observer);
-                npc->subscribe(file_observer);
-                npcs.push_back(npc);
-            }
-        } catch (...) {}
+        total = npcs.size();
     }
+    index_stale = true;
+    density_stale = true;
     
     std::lock_guard<std::mutex> lock_cout(cout_mutex);
-    std::cout << "Game initialized with " << npcs.size() << " NPCs\n";
+    std::cout << "Game initialized with " << total << " NPCs\n";
 }
 
 void Game::movement_worker() {
+    NpcSnapshot snapshot;
+    CombatView view;
+    std::vector<uint32_t> dense_of_slot;
+    uint32_t ticks_since_reorder = 0;
+    
     while (game_running) {
-        {
-            std::shared_lock<std::shared_mutex> lock(npcs_mutex);
-            
-            if (!game_running) break;
-            
-            if (npcs.empty()) {
-                std::this_thread::sleep_for(50ms);
-                continue;
-            }
-            
-            for (auto& npc : npcs) {
-                if (!game_running) break;  
-                if (npc && npc->is_alive()) {
-                    npc->move();
-                }
-            }
-        }
+        take_snapshot(snapshot);
         
-        if (!game_running) break;  
+        if (snapshot.npcs.empty()) {
+            std::this_thread::sleep_for(50ms);
+            continue;
+        }
         
-        check_collisions();
+        movement_tick(snapshot, view, dense_of_slot, ticks_since_reorder);
+        snapshot.clear();   // на время паузы убранные NPC не удерживаются
         std::this_thread::sleep_for(50ms);
     }
 }
 
-void Game::check_collisions() {
-    std::shared_lock<std::shared_mutex> lock(npcs_mutex);
+// Один тик движения без паузы: шаги NPC, столкновения и при нужде переупорядочивание
+void Game::movement_tick(const NpcSnapshot& snapshot, CombatView& view, std::vector<uint32_t>& dense_of_slot,
+                         uint32_t& ticks_since_reorder) {
+    PHASE_TIMER(TickPhase::TICK);
+    // Каждый регион двигает только своих NPC. npcs_mutex охраняет лишь
+    // структуру хранилища и держится только на время снимка; координаты -
+    // atomic, поэтому читатели других потоков движение не ждут
+    assign_regions(snapshot, view);
+    size_t threads = std::min(default_thread_count(), snapshot.size() / MIN_NPCS_PER_THREAD + 1);
     
-    if (!game_running || npcs.empty()) return;
+    // Хищник идёт к ближайшей добыче по координатам на границе тика;
+    // без добычи в мире он шагает случайно
+    bool seek = movement_mode == MovementMode::SEEK_PREY;
+    std::shared_lock<std::shared_mutex> index_lock(index_mutex, std::defer_lock);
+    // По тому же индексу ищутся столкновения квадродеревом и рисуется мелкое окно карты
+    if (seek || index_kind == SpatialIndexKind::QUADTREE || map_wants_index) {
+        refresh_index(snapshot, view, dense_of_slot);
+    }
     
-    for (size_t i = 0; i < npcs.size(); ++i) {
-        auto& attacker = npcs[i];
-        if (!attacker || !attacker->is_alive()) continue;
-        
-        auto config = attacker->get_movement_config();
+    // Столкновения - по тем же координатам на границе тика, до шагов: снимок,
+    // регионы и индекс строятся один раз на тик
+    check_collisions(snapshot, view, dense_of_slot, threads);
+    
+    if (seek) {
+        index_lock.lock();
+    }
+    
+    {
+        PHASE_TIMER(TickPhase::MOVEMENT);
+        shards.for_each_region(threads, [&](size_t region) {
+            std::vector<Neighbour> targets;
+            const uint32_t* members = shards.owned(region);
+            for (size_t k = 0; k < shards.owned_count(region); ++k) {
+                if (!game_running) break;
+                uint32_t i = members[k];
+                BaseNpc* npc = snapshot.npcs[i];
+                if (!npc || !npc->is_alive()) continue;
         
-        for (size_t j = 0; j < npcs.size(); ++j) {
-            if (i == j) continue;
-            
-            auto& defender = npcs[j];
-            if (!defender || !defender->is_alive()) continue;
-            
-            double distance = attacker->get_position().distance_to(defender->get_position());
-            if (distance <= config.kill_distance) {
-                std::lock_guard<std::mutex> qlock(battle_queue_mutex);
-                battle_queue.push({attacker, defender});
+                const TypeMask& prey = prey_mask(view.types[i]);
+                if (seek && prey.any()) {
+                    // Вид может охотиться на своих: себя пропускаем
+                    world_index.nearest(view.position(i), prey, 2, targets);
+                    uint32_t own_slot = snapshot.handles[i].index();
+                    auto target = std::find_if(targets.begin(), targets.end(), [&](const Neighbour& n) {
+                        return n.id != own_slot;
+                    });
+                    if (target != targets.end()) {
+                        npc->move_towards(view.position(dense_of_slot[target->id]), world_bounds);
+                        continue;
+                    }
+                }
+                npc->move(world_bounds);
             }
+        });
+    }
+    if (index_lock.owns_lock()) {
+        index_lock.unlock();
+    }
+    index_stale = true;   // NPC сдвинулись после refresh_index
+    
+    if (!game_running) return;
+    
+    refresh_density(snapshot);
+    ++tick_count;
+    
+    // Беспорядок оценивается по координатам на границе тика: за тик он почти не меняется
+    ++ticks_since_reorder;
+    bool by_interval = reorder_interval > 0 && ticks_since_reorder >= reorder_interval;
+    if ((by_interval || morton_disorder(view.positions, MORTON_CELL_SIZE) > reorder_threshold) &&
+        reorder_storage()) {
+        ticks_since_reorder = 0;
+    }
+}
+
+// Метка берётся до чтения хранилища, поэтому убранные после неё NPC живы,
+// пока жив снимок; счётчики shared_ptr не трогаются
+void Game::take_snapshot(NpcSnapshot& snapshot) const {
+    snapshot.pin = graveyard.pin();
+    std::shared_lock<std::shared_mutex> lock(npcs_mutex);
+    snapshot.npcs.resize(npcs.size());
+    snapshot.handles.resize(npcs.size());
+    size_t i = 0;
+    for (const auto& npc : npcs) {
+        snapshot.npcs[i] = npc.get();
+        snapshot.handles[i] = npcs.handle_at(i);
+        ++i;
+    }
+}
+
+// Граница тика: NPC, перешедшие границу региона, переходят к новому владельцу
+void Game::assign_regions(const NpcSnapshot& snapshot, CombatView& view) {
+    view.assign(snapshot.npcs.begin(), snapshot.npcs.end());
+    std::vector<uint32_t> slot_ids(snapshot.size());
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        slot_ids[i] = snapshot.handles[i].index();
+    }
+    shards.assign(view, slot_ids);
+}
+
+// Сетка ведётся по номерам слотов: счётчики меняются только у NPC, сменивших
+// клетку, а мёртвые и убранные из хранилища стираются. NPC вне границ мира
+// учитываются только в итоге.
+void Game::refresh_density(const NpcSnapshot& snapshot) {
+    std::lock_guard<std::shared_mutex> lock(density_mutex);
+    size_t types = SpeciesRegistry::instance().size();
+    if (density.empty() || density.get_type_count() != types || density.get_bounds() != world_bounds) {
+        density.reset(world_bounds, types);
+    }
+    std::vector<uint8_t> seen(density.id_capacity(), 0);
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        const auto& npc = snapshot.npcs[i];
+        uint32_t slot = snapshot.handles[i].index();
+        if (npc && npc->is_alive()) {
+            density.update(slot, npc->get_type(), npc->get_position());
+            if (slot < seen.size()) seen[slot] = 1;
+        } else {
+            density.erase(slot);
         }
     }
+    for (uint32_t slot = 0; slot < seen.size(); ++slot) {
+        if (!seen[slot]) density.erase(slot);
+    }
+    density.build_sums();
+}
+
+// Вне игры сетку никто не обновляет: пересчёт, если хранилище менялось
+void Game::ensure_density() {
+    if (!game_running && density_stale.exchange(false)) {
+        NpcSnapshot snapshot;
+        take_snapshot(snapshot);
+        refresh_density(snapshot);
+    }
+}
+
+// Сдвинувшиеся NPC переносятся в индексе по одному; мёртвые и убранные
+// из хранилища удаляются. dense_of_slot[слот] - индекс в snapshot.
+void Game::refresh_index(const NpcSnapshot& snapshot, const CombatView& view, std::vector<uint32_t>& dense_of_slot) {
+    std::lock_guard<std::shared_mutex> lock(index_mutex);
+    dense_of_slot.assign(snapshot.size(), NO_SLOT);
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        uint32_t slot = snapshot.handles[i].index();
+        if (slot >= dense_of_slot.size()) {
+            dense_of_slot.resize(static_cast<size_t>(slot) + 1, NO_SLOT);
+        }
+        if (slot >= handle_of_slot.size()) {
+            handle_of_slot.resize(static_cast<size_t>(slot) + 1);
+        }
+        dense_of_slot[slot] = static_cast<uint32_t>(i);
+        handle_of_slot[slot] = snapshot.handles[i];
+        if (view.alive[i]) {
+            world_index.update(slot, view.types[i], view.position(i));
+        } else {
+            world_index.erase(slot);
+        }
+    }
+    for (uint32_t slot : indexed_slots) {
+        if (slot >= dense_of_slot.size() || dense_of_slot[slot] == NO_SLOT) {
+            world_index.erase(slot);
+        }
+    }
+    indexed_slots.resize(snapshot.size());
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        indexed_slots[i] = snapshot.handles[i].index();
+    }
+}
+
+void Game::ensure_index() {
+    if (!index_stale.exchange(false)) return;
+    NpcSnapshot snapshot;
+    take_snapshot(snapshot);
+    CombatView view;
+    view.assign(snapshot.npcs.begin(), snapshot.npcs.end());
+    std::vector<uint32_t> dense_of_slot;
+    refresh_index(snapshot, view, dense_of_slot);
+}
+
+std::vector<NpcHandle> Game::nearest(const Position& pos, const TypeMask& types, size_t k) {
+    ensure_index();
+    std::vector<Neighbour> found;
+    std::vector<NpcHandle> result;
+    std::shared_lock<std::shared_mutex> lock(index_mutex);
+    world_index.nearest(pos, types, k, found);
+    for (const auto& neighbour : found) {
+        result.push_back(handle_of_slot[neighbour.id]);
+    }
+    return result;
+}
+
+std::vector<NpcHandle> Game::query_radius(const Position& pos, int range, const TypeMask& types) {
+    ensure_index();
+    std::vector<uint32_t> slots;
+    std::vector<NpcHandle> result;
+    std::shared_lock<std::shared_mutex> lock(index_mutex);
+    world_index.query_radius(pos, range, types, slots);
+    for (uint32_t slot : slots) {
+        result.push_back(handle_of_slot[slot]);
+    }
+    return result;
+}
+
+uint64_t Game::count_in_rect(const GameConfig& rect, const TypeMask& types) {
+    ensure_density();
+    std::shared_lock<std::shared_mutex> lock(density_mutex);
+    return density.count(types, rect.min_x, rect.min_y, rect.max_x, rect.max_y);
+}
+
+uint64_t Game::count_in_rect(const GameConfig& rect, NpcType type) {
+    ensure_density();
+    std::shared_lock<std::shared_mutex> lock(density_mutex);
+    return density.count(type, rect.min_x, rect.min_y, rect.max_x, rect.max_y);
+}
+
+int Game::get_density_cell_size() {
+    ensure_density();
+    std::shared_lock<std::shared_mutex> lock(density_mutex);
+    return density.get_cell_size();
+}
+
+void Game::check_collisions(const NpcSnapshot& snapshot, const CombatView& view,
+                            const std::vector<uint32_t>& dense_of_slot, size_t threads) {
+    if (!game_running || snapshot.npcs.empty()) return;
+    PHASE_TIMER(TickPhase::COLLISIONS);
+    
+    // Пары, в которых бой невозможен, в очередь не попадают
+    std::vector<CombatPair> pairs;
+    if (index_kind == SpatialIndexKind::QUADTREE) {
+        // Один индекс на всю карту, обновлённый movement_tick, вместо перестройки в каждом регионе
+        std::shared_lock<std::shared_mutex> index_lock(index_mutex);
+        SnapshotTreeIndex index(world_index, dense_of_slot);
+        battle.find_collisions(view, index, view.size(), pairs, DeterministicPolicy(threads, MIN_NPCS_PER_THREAD));
+    } else {
+        shards.find_collisions(battle, view, pairs, threads);
+    }
+    if (pairs.empty()) return;
+    
+    PHASE_TIMER(TickPhase::QUEUE_PUSH);
+    std::lock_guard<std::mutex> qlock(battle_queue_mutex);
+    for (const auto& pair : pairs) {
+        battle_queue.push({snapshot.handles[pair.attacker], snapshot.handles[pair.defender]});
+    }
 }
 
 void Game::battle_worker() {
+    std::vector<BattleTask> tasks;
+    std::vector<Duel> duels;
+    auto last_sample = std::chrono::steady_clock::now();
+    uint64_t last_ticks = 0;
+    
     while (game_running) {
-        BattleTask task;
-        bool has_task = false;
-        
+        // За проход берётся вся очередь, накопленная за паузу в 100 мс, а не
+        // одна задача: бои идут пачками раз в проход
+        tasks.clear();
         {
+            PHASE_TIMER(TickPhase::QUEUE_DRAIN);
             std::lock_guard<std::mutex> lock(battle_queue_mutex);
-            if (!battle_queue.empty()) {
-                task = battle_queue.front();
+            while (!battle_queue.empty()) {
+                tasks.push_back(battle_queue.front());
                 battle_queue.pop();
-                has_task = true;
             }
         }
         
         if (!game_running) break;
         
-        if (has_task && task.attacker && task.defender && 
-            task.attacker->is_alive() && task.defender->is_alive()) {
-            
-            auto visitor = std::make_shared<FightVisitor>(task.attacker->get_type());
-            if (task.defender->accept(visitor)) {
-                int attack = task.attacker->roll_dice();
-                int defense = task.defender->roll_dice();
-                
-                if (attack > defense) {
-                    task.defender->kill();
-                    task.attacker->notify_kill(task.defender);
-                    
-                    {
-                        std::lock_guard<std::mutex> lock(cout_mutex);
-                        std::cout << "BATTLE: " << task.attacker->get_name() 
-                                  << " killed " << task.defender->get_name()
-                                  << " (" << attack << " vs " << defense << ")\n";
+        // Пока очередь ждала, check_collisions мог найти ту же пару ещё раз
+        auto task_key = [](const BattleTask& task) {
+            return std::make_pair(task.attacker.value, task.defender.value);
+        };
+        std::stable_sort(tasks.begin(), tasks.end(), [&](const BattleTask& a, const BattleTask& b) {
+            return task_key(a) < task_key(b);
+        });
+        tasks.erase(std::unique(tasks.begin(), tasks.end(), [&](const BattleTask& a, const BattleTask& b) {
+            return task_key(a) == task_key(b);
+        }), tasks.end());
+        
+        std::ostringstream report;
+        
+        if (!tasks.empty()) {
+            // Метка держит бойцов до конца отчёта, даже если их уберёт fight() редактора
+            NpcPin pin = graveyard.pin();
+            {
+                PHASE_TIMER(TickPhase::BATTLE);
+                // Дескриптор устарел, если NPC уже убран cleanup_dead_npcs
+                duels.assign(tasks.size(), Duel{});
+                {
+                    std::shared_lock<std::shared_mutex> lock(npcs_mutex);
+                    for (size_t i = 0; i < tasks.size(); ++i) {
+                        auto* attacker = npcs.get(tasks[i].attacker);
+                        auto* defender = npcs.get(tasks[i].defender);
+                        if (attacker) duels[i].attacker = attacker->get();
+                        if (defender) duels[i].defender = defender->get();
                     }
-                } else {
-                    std::lock_guard<std::mutex> lock(cout_mutex);
-                    std::cout << "BATTLE: " << task.attacker->get_name() 
-                              << " missed " << task.defender->get_name()
-                              << " (" << attack << " vs " << defense << ")\n";
                 }
+            
+                battle.resolve_duels(duels);
+            }
+            
+            PHASE_TIMER(TickPhase::LOGGING);
+            for (size_t i = 0; i < duels.size(); ++i) {
+                const Duel& duel = duels[i];
+                if (!duel.fought) continue;
+                if (duel.killed) {
+                    notify_kill(*duel.attacker, tasks[i].attacker, *duel.defender, tasks[i].defender);
+                }
+                const char* outcome = duel.killed ? " killed "
+                                    : duel.lost_claim ? " beat, but someone else killed "
+                                    : " missed ";
+                report << "BATTLE: " << duel.attacker->get_name_id() << outcome << duel.defender->get_name_id()
+                       << " (" << duel.attack << " vs " << duel.defense << ")\n";
             }
         }
         
-        cleanup_dead_npcs();
+        std::string text = report.str();
+        if (!text.empty()) {
+            PHASE_TIMER(TickPhase::CONSOLE);
+            std::lock_guard<std::mutex> lock(cout_mutex);
+            std::cout << text;
+        }
+        
+        bool respawn = respawn_enabled;
+        {
+            // Замер только здесь: fight() редактора тоже убирает мёртвых, но это не тик
+            PHASE_TIMER(TickPhase::CLEANUP);
+            cleanup_dead_npcs(respawn);
+        }
+        if (respawn) {
+            respawn_population();
+        }
+        record_tick_rate(last_sample, last_ticks);
         std::this_thread::sleep_for(100ms);
     }
 }
 
-void Game::cleanup_dead_npcs() {
-    std::lock_guard<std::shared_mutex> lock(npcs_mutex);
-    
-    auto new_end = std::remove_if(npcs.begin(), npcs.end(),
-        [](const std::shared_ptr<INpc>& npc) {
-            return !npc || !npc->is_alive();
+void Game::notify_kill(const BaseNpc& killer, NpcHandle killer_handle, const BaseNpc& victim, NpcHandle victim_handle) {
+    index_stale = true;
+    density_stale = true;
+    KillEvent event{killer_handle, victim_handle, killer.get_name_id(), victim.get_name_id()};
+    console_observer->on_kill_event(event);
+    file_observer->on_kill_event(event);
+}
+
+void Game::cleanup_dead_npcs(bool respawn) {
+    if (respawn) {
+        alive_by_type.assign(SpeciesRegistry::instance().size(), 0);
+    }
+    std::vector<std::shared_ptr<BaseNpc>> dead;
+    size_t removed;
+    {
+        std::lock_guard<std::shared_mutex> lock(npcs_mutex);
+        removed = npcs.erase_if([&](const std::shared_ptr<BaseNpc>& npc) {
+            if (!npc || !npc->is_alive()) {
+                if (respawn && npc) freed_names.push_back(npc->get_name_id());
+                if (npc) dead.push_back(npc);
+                return true;
+            }
+            if (respawn && type_index(npc->get_type()) < alive_by_type.size()) {
+                ++alive_by_type[type_index(npc->get_type())];
+            }
+            return false;
         });
+    }
+    graveyard.bury(dead);   // снимки, взятые до уборки, ещё могут на них смотреть
+    if (removed > 0) {
+        index_stale = true;
+        density_stale = true;
+    }
+}
+
+// Сначала освобождаются имена убранных: новые NPC того же вида получают их
+// раньше новых номеров. Вставка одна на проход, как в add_npcs.
+void Game::respawn_population() {
+    PHASE_TIMER(TickPhase::RESPAWN);
+    std::vector<size_t> target = get_population_target();
     
-    if (new_end != npcs.end()) {
-        npcs.erase(new_end, npcs.end());
+    GameConfig area;
+    std::vector<std::shared_ptr<BaseNpc>> spawned;
+    {
+        std::shared_lock<std::shared_mutex> lock(factory_mutex);
+        for (const auto& name : freed_names) {
+            factory.release_name(name);
+        }
+        freed_names.clear();
+        
+        // Фабрика проверяет свои границы, поэтому точки берутся из их пересечения с миром
+        GameConfig limits = factory.get_config();
+        area = {std::max(world_bounds.min_x, limits.min_x), std::min(world_bounds.max_x, limits.max_x),
+                std::max(world_bounds.min_y, limits.min_y), std::min(world_bounds.max_y, limits.max_y)};
+        if (area.width() <= 0 || area.height() <= 0) return;
+        std::uniform_int_distribution<int> x(area.min_x, area.max_x);
+        std::uniform_int_distribution<int> y(area.min_y, area.max_y);
+        
+        size_t budget = RESPAWN_BATCH_LIMIT;
+        for (size_t t = 0; t < target.size() && budget > 0; ++t) {
+            size_t alive = t < alive_by_type.size() ? alive_by_type[t] : 0;
+            size_t missing = target[t] > alive ? std::min(target[t] - alive, budget) : 0;
+            budget -= missing;
+            NpcType type = static_cast<NpcType>(t);
+            std::string_view base_name = species(type).display_name;
+            for (size_t i = 0; i < missing; ++i) {
+                int px = x(respawn_rng);
+                int py = y(respawn_rng);
+                spawned.push_back(factory.create_npc(type, base_name, px, py));
+            }
+        }
     }
+    if (spawned.empty()) return;
+    
+    {
+        std::lock_guard<std::shared_mutex> lock(npcs_mutex);
+        npcs.reserve(npcs.size() + spawned.size());
+        for (auto& npc : spawned) {
+            npcs.insert(std::move(npc));
+        }
+    }
+    index_stale = true;
+    density_stale = true;
+    respawn_count += spawned.size();
+}
+
+void Game::record_tick_rate(std::chrono::steady_clock::time_point& last_sample, uint64_t& last_ticks) {
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<double> interval = now - last_sample;
+    if (interval < std::chrono::milliseconds(TICK_RATE_SAMPLE_MS)) return;
+    
+    uint64_t ticks = tick_count.load();
+    TickRateSample sample;
+    sample.seconds = std::chrono::duration<double>(now - game_start_time).count();
+    sample.ticks_per_second = static_cast<double>(ticks - last_ticks) / interval.count();
+    sample.alive = static_cast<size_t>(get_alive_count());
+    last_sample = now;
+    last_ticks = ticks;
+    
+    std::lock_guard<std::mutex> lock(tick_rate_mutex);
+    tick_rate_history.push_back(sample);
+    if (tick_rate_history.size() > static_cast<size_t>(TICK_RATE_HISTORY)) {
+        tick_rate_history.pop_front();
+    }
+}
+
+std::vector<TickRateSample> Game::get_tick_rate_history() const {
+    std::lock_guard<std::mutex> lock(tick_rate_mutex);
+    return std::vector<TickRateSample>(tick_rate_history.begin(), tick_rate_history.end());
+}
+
+void Game::print_phase_profile() {
+    std::ostringstream out;
+    if (PHASE_PROFILER_ENABLED) {
+        PhaseProfiler::instance().print(out);
+        PhaseProfiler::instance().reset();
+    } else {
+        out << "Phase profiler is disabled in this build (configure with -DENABLE_PHASE_PROFILER=ON)\n";
+    }
+    std::lock_guard<std::mutex> lock(cout_mutex);
+    std::cout << out.str();
+}
+
+void Game::set_population_target(const std::vector<size_t>& target) {
+    if (target.size() > SpeciesRegistry::instance().size()) {
+        throw std::invalid_argument("Population target has more types than the species registry");
+    }
+    std::lock_guard<std::mutex> lock(population_mutex);
+    population_target = target;
+    respawn_enabled = std::any_of(target.begin(), target.end(), [](size_t n) { return n > 0; });
+}
+
+std::vector<size_t> Game::get_population_target() const {
+    std::lock_guard<std::mutex> lock(population_mutex);
+    return population_target;
 }
 
 void Game::start() {
     if (game_running) return;
     
     game_running = true;
+    tick_count = 0;
     game_start_time = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(tick_rate_mutex);
+        tick_rate_history.clear();
+    }
     
     movement_thread = std::thread(&Game::movement_worker, this);
     battle_thread = std::thread(&Game::battle_worker, this);
@@ -321,6 +844,8 @@ void Game::stop() {
     
     if (movement_thread.joinable()) movement_thread.join();
     if (battle_thread.joinable()) battle_thread.join();
+    // Сетка последнего тика могла пропустить бои и добавления после него
+    density_stale = true;
     
     {
         std::lock_guard<std::mutex> lock(battle_queue_mutex);
@@ -333,6 +858,68 @@ void Game::stop() {
     std::cout << "Game stopped\n";
 }
 
+void Game::set_world_bounds(const GameConfig& bounds) {
+    if (game_running || live_map_running) {
+        throw std::logic_error("World bounds can only be changed while the game and the live map are stopped");
+    }
+    if (bounds.width() <= 0 || bounds.height() <= 0) {
+        throw std::invalid_argument("World bounds must not be empty");
+    }
+    world_bounds = bounds;
+    density_stale = true;
+}
+
+void Game::set_storage_reorder(uint32_t interval_ticks, double disorder_threshold) {
+    if (game_running) {
+        throw std::logic_error("Storage reorder can only be changed while the game is stopped");
+    }
+    reorder_interval = interval_ticks;
+    reorder_threshold = disorder_threshold;
+}
+
+// Порядок считается по снимку без замка хранилища; под замком он только
+// применяется, если с момента снимка никто не добавил и не убрал NPC.
+// Дескрипторы не меняются, поэтому очередь боёв и индекс по слотам не трогаются.
+bool Game::reorder_storage() {
+    NpcSnapshot snapshot;
+    take_snapshot(snapshot);
+    if (snapshot.size() < 2) return false;
+    
+    PositionBlock positions;
+    positions.reserve(snapshot.size());
+    for (const auto& npc : snapshot.npcs) {
+        positions.push_back(npc ? npc->get_position() : Position{0, 0});
+    }
+    std::vector<uint32_t> order = morton_order(positions);
+    
+    std::lock_guard<std::shared_mutex> lock(npcs_mutex);
+    if (npcs.size() != snapshot.size()) return false;
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        if (npcs.handle_at(i) != snapshot.handles[i]) return false;
+    }
+    npcs.reorder(order);
+    ++reorder_count;
+    return true;
+}
+
+double Game::get_storage_disorder() const {
+    NpcSnapshot snapshot;
+    take_snapshot(snapshot);
+    PositionBlock positions;
+    positions.reserve(snapshot.size());
+    for (const auto& npc : snapshot.npcs) {
+        positions.push_back(npc ? npc->get_position() : Position{0, 0});
+    }
+    return morton_disorder(positions, MORTON_CELL_SIZE);
+}
+
+void Game::set_spatial_index(SpatialIndexKind kind) {
+    if (game_running) {
+        throw std::logic_error("Spatial index can only be changed while the game is stopped");
+    }
+    index_kind = kind;
+}
+
 int Game::get_game_time() const {
     if (!game_running) {
         auto elapsed = std::chrono::steady_clock::now() - game_start_time;
@@ -342,69 +929,277 @@ int Game::get_game_time() const {
     return static_cast<int>(std::chrono::duration_cast<std::chrono::seconds>(elapsed).count());
 }
 
-void Game::print_map() {
-    std::lock_guard<std::mutex> cout_lock(cout_mutex);
-    std::shared_lock<std::shared_mutex> npc_lock(npcs_mutex);
+void Game::compose_map_frame(FrameBuffer& frame) {
+    ensure_density();
+    size_t total;
+    {
+        std::shared_lock<std::shared_mutex> lock(npcs_mutex);
+        total = npcs.size();
+    }
+    GameConfig view = get_map_viewport();
+    MapLayer layer = map_layer;
     
     auto now = std::chrono::steady_clock::now();
     int game_time = static_cast<int>(
         std::chrono::duration_cast<std::chrono::seconds>(now - game_start_time).count()
     );
 
-    char map[MAP_HEIGHT][MAP_WIDTH];
-    for (int y = 0; y < MAP_HEIGHT; ++y) {
-        for (int x = 0; x < MAP_WIDTH; ++x) {
-            map[y][x] = '.';  // '.' = пустая клетка
+    // Окно больше экрана выводится с уменьшением: символ покрывает scale x scale клеток
+    int64_t scale = std::max<int64_t>(1, (std::max(view.width(), view.height()) + MAP_VIEW_SIZE - 1) / MAP_VIEW_SIZE);
+    int view_width = static_cast<int>((view.width() + scale - 1) / scale);
+    int view_height = static_cast<int>((view.height() + scale - 1) / scale);
+
+    // Под density_mutex только подсчёт: на символ - число NPC и преобладающий
+    // вид. Строки и кадр собираются без замка, чтобы медленная карта не
+    // задерживала refresh_density потока движения.
+    size_t symbols = static_cast<size_t>(view_width) * view_height;
+    std::vector<uint64_t> totals(symbols, 0);
+    std::vector<uint16_t> dominant(symbols, 0);
+    int grid_cell;
+    size_t counted;
+    size_t types;
+    bool exact;
+    {
+        std::shared_lock<std::shared_mutex> density_lock(density_mutex);
+        grid_cell = density.get_cell_size();
+        counted = density.get_total();
+        types = density.get_type_count();
+        // Символ мельче клетки сетки: суммы дали бы на все его символы одно
+        // число, поэтому NPC окна берутся из world_index
+        exact = grid_cell > scale;
+        // На символ - по одному запросу к префиксным суммам каждого вида
+        for (int y = 0; y < view_height && !exact; ++y) {
+            int min_y = static_cast<int>(view.min_y + y * scale);
+            int max_y = static_cast<int>(std::min<int64_t>(view.max_y, min_y + scale - 1));
+            for (int x = 0; x < view_width; ++x) {
+                int min_x = static_cast<int>(view.min_x + x * scale);
+                int max_x = static_cast<int>(std::min<int64_t>(view.max_x, min_x + scale - 1));
+                size_t symbol = static_cast<size_t>(y) * view_width + x;
+                uint32_t best = 0;
+                for (size_t t = 0; t < types; ++t) {
+                    uint32_t n = density.count(static_cast<NpcType>(t), min_x, min_y, max_x, max_y);
+                    totals[symbol] += n;
+                    if (n > best) {
+                        best = n;
+                        dominant[symbol] = static_cast<uint16_t>(t);
+                    }
+                }
+            }
         }
     }
+    // Пока окно мелкое, поток движения держит индекс свежим сам
+    map_wants_index = exact;
+    if (exact) {
+        count_visible_npcs(view, scale, view_width, types, totals, dominant);
+    }
 
-    for (const auto& npc : npcs) {
-        if (npc && npc->is_alive()) {
-            Position pos = npc->get_position();
-            if (pos.x >= 0 && pos.x < MAP_WIDTH && pos.y >= 0 && pos.y < MAP_HEIGHT) {
-                if (map[pos.y][pos.x] == '.') {
-                    switch (npc->get_type()) {
-                        case NpcType::DRAGON: map[pos.y][pos.x] = 'D'; break;
-                        case NpcType::FROG:   map[pos.y][pos.x] = 'F'; break;
-                        case NpcType::BULL:   map[pos.y][pos.x] = 'B'; break;
-                        default:              map[pos.y][pos.x] = '?';
-                    }
+    std::ostringstream title;
+    title << "MAP (" << std::setw(2) << game_time << "s)";
+    std::vector<std::string> header = {"+==================================================+"};
+    push_boxed(header, std::string((MAP_BOX_TEXT - title.str().size()) / 2, ' ') + title.str());
+    header.push_back("+==================================================+");
+    if (layer == MapLayer::TYPES) {
+        push_boxed(header, "SYMBOLS: D=Dragon, F=Frog, B=Bull, .=Empty");
+    } else {
+        push_boxed(header, "DENSITY: digit d = 2^(d-1)+ NPCs, .=Empty");
+    }
+    if (scale > 1 || view != world_bounds) {
+        push_boxed(header, "VIEW: x " + std::to_string(view.min_x) + ".." + std::to_string(view.max_x) +
+                           ", y " + std::to_string(view.min_y) + ".." + std::to_string(view.max_y) +
+                           ", 1 symbol = " + std::to_string(scale) + "x" + std::to_string(scale) + " cells");
+    }
+    header.push_back("+--------------------------------------------------+");
+    const int footer_rows = 3;
+    int top = static_cast<int>(header.size());
+
+    frame.resize(std::max(view_width, static_cast<int>(header[0].size())), top + view_height + footer_rows);
+    for (int row = 0; row < top; ++row) {
+        frame.put_text(row, 0, header[row]);
+    }
+
+    for (int y = 0; y < view_height; ++y) {
+        for (int x = 0; x < view_width; ++x) {
+            size_t index = static_cast<size_t>(y) * view_width + x;
+            uint64_t cell_total = totals[index];
+            char symbol = '.';  // '.' = пустая клетка
+            if (cell_total > 0 && layer == MapLayer::TYPES) {
+                symbol = species(static_cast<NpcType>(dominant[index])).symbol;
+            } else if (cell_total > 0) {
+                int digits = 0;
+                for (uint64_t n = cell_total; n > 0 && digits < 9; n >>= 1) {
+                    ++digits;
                 }
+                symbol = static_cast<char>('0' + digits);
             }
+            frame.at(x, top + y) = symbol;
         }
     }
 
-    std::cout << "\n";
-    std::cout << "+==================================================+\n";
-    std::cout << "|                 MAP (" << std::setw(2) << game_time << "s)                   |\n";
-    std::cout << "+==================================================+\n";
-    std::cout << "| SYMBOLS: D=Dragon, F=Frog, B=Bull, .=Empty      |\n";
-    std::cout << "+--------------------------------------------------+\n";
+    // Живые - по сетке последнего пересчёта, поэтому мёртвых не бывает меньше нуля
+    size_t alive_count = std::min(counted, total);
+    std::ostringstream footer;
+    footer << "| Alive: " << std::setw(3) << alive_count
+           << " | Dead: " << std::setw(3) << (total - alive_count)
+           << " | Total: " << std::setw(3) << total << " |";
+    int bottom = top + view_height;
+    frame.put_text(bottom, 0, "+--------------------------------------------------+");
+    frame.put_text(bottom + 1, 0, footer.str());
+    frame.put_text(bottom + 2, 0, "+==================================================+");
+}
 
-    for (int y = 0; y < MAP_HEIGHT; ++y) {
-        for (int x = 0; x < MAP_WIDTH; ++x) {
-            std::cout << map[y][x];
+// Окно мельче клетки сетки плотности: NPC окна по деревьям видов, работа -
+// по числу видимых NPC. Вне игры индекс обновляется здесь, в игре - потоком
+// движения, пока map_wants_index.
+void Game::count_visible_npcs(const GameConfig& view, int64_t scale, int view_width, size_t types,
+                              std::vector<uint64_t>& totals, std::vector<uint16_t>& dominant) {
+    if (!game_running) {
+        ensure_index();
+    }
+    std::vector<uint32_t> of_type(totals.size(), 0);
+    std::vector<uint32_t> best(totals.size(), 0);
+    std::vector<size_t> touched;
+    std::vector<uint32_t> slots;
+    std::shared_lock<std::shared_mutex> lock(index_mutex);
+    for (size_t t = 0; t < types; ++t) {
+        slots.clear();
+        world_index.query_rect(view.min_x, view.min_y, view.max_x, view.max_y, type_mask(static_cast<NpcType>(t)), slots);
+        for (uint32_t slot : slots) {
+            Position pos = world_index.position(slot);
+            size_t symbol = static_cast<size_t>((pos.y - int64_t(view.min_y)) / scale) * view_width +
+                            static_cast<size_t>((pos.x - int64_t(view.min_x)) / scale);
+            if (of_type[symbol]++ == 0) touched.push_back(symbol);
+        }
+        for (size_t symbol : touched) {
+            totals[symbol] += of_type[symbol];
+            if (of_type[symbol] > best[symbol]) {
+                best[symbol] = of_type[symbol];
+                dominant[symbol] = static_cast<uint16_t>(t);
+            }
+            of_type[symbol] = 0;
         }
-        std::cout << "\n";
+        touched.clear();
+    }
+}
+
+void Game::print_map() {
+    FrameBuffer frame;
+    compose_map_frame(frame);
+    std::string text = "\n" + MapRenderer::plain(frame);
+    
+    // cout_mutex - только на запись, чтобы кадр не перемешался с другим выводом
+    std::lock_guard<std::mutex> cout_lock(cout_mutex);
+    if (frame_writer) {
+        frame_writer(text);
+    } else {
+        write_to_terminal(text);
+    }
+}
+
+void Game::set_map_viewport(const GameConfig& viewport) {
+    if (viewport.width() <= 0 || viewport.height() <= 0) {
+        throw std::invalid_argument("Map viewport must not be empty");
+    }
+    std::lock_guard<std::mutex> lock(viewport_mutex);
+    map_viewport = viewport;
+    viewport_set = true;
+}
+
+void Game::reset_map_viewport() {
+    std::lock_guard<std::mutex> lock(viewport_mutex);
+    viewport_set = false;
+}
+
+// Окно, целиком ушедшее за границы мира (мир могли уменьшить), - весь мир
+GameConfig Game::get_map_viewport() const {
+    std::lock_guard<std::mutex> lock(viewport_mutex);
+    if (!viewport_set) return world_bounds;
+    GameConfig view;
+    view.min_x = std::max(map_viewport.min_x, world_bounds.min_x);
+    view.max_x = std::min(map_viewport.max_x, world_bounds.max_x);
+    view.min_y = std::max(map_viewport.min_y, world_bounds.min_y);
+    view.max_y = std::min(map_viewport.max_y, world_bounds.max_y);
+    if (view.width() <= 0 || view.height() <= 0) return world_bounds;
+    return view;
+}
+
+void Game::set_frame_writer(FrameWriter writer) {
+    if (live_map_running) {
+        throw std::logic_error("Frame writer can only be changed while the live map is stopped");
     }
+    frame_writer = std::move(writer);
+}
+
+void Game::start_live_map(int fps) {
+    if (fps <= 0) {
+        throw std::invalid_argument("Frame rate must be positive");
+    }
+    if (live_map_running.exchange(true)) return;
+    frames_rendered = 0;
+    frames_dropped = 0;
+    render_thread = std::thread(&Game::render_worker, this, fps);
+}
 
-    int alive_count = get_alive_count();
-    std::cout << "+--------------------------------------------------+\n";
-    std::cout << "| Alive: " << std::setw(3) << alive_count
-              << " | Dead: " << std::setw(3) << (npcs.size() - alive_count)
-              << " | Total: " << std::setw(3) << npcs.size() << " |\n";
-    std::cout << "+==================================================+\n";
+void Game::stop_live_map() {
+    if (!live_map_running.exchange(false)) return;
+    if (render_thread.joinable()) {
+        render_thread.join();
+    }
+}
+
+// Кадры идут по расписанию: опоздавший кадр не сдвигает следующие сроки,
+// а если отрисовка отстала больше чем на кадр, пропущенные сроки отбрасываются
+void Game::render_worker(int fps) {
+    MapRenderer renderer;
+    FrameBuffer frame;
+    auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds(1)) / fps;
+    auto deadline = std::chrono::steady_clock::now();
+    
+    while (live_map_running) {
+        compose_map_frame(frame);
+        std::string text = renderer.next(frame);
+        if (!text.empty()) {
+            std::lock_guard<std::mutex> cout_lock(cout_mutex);
+            if (frame_writer) {
+                frame_writer(text);
+            } else {
+                write_to_terminal(text);
+            }
+        }
+        ++frames_rendered;
+        
+        deadline += period;
+        auto now = std::chrono::steady_clock::now();
+        if (now > deadline + period) {
+            frames_dropped += static_cast<uint64_t>((now - deadline) / period);
+            deadline = now;
+        }
+        std::this_thread::sleep_until(deadline);
+    }
 }
 
 void Game::print_survivors() {
-    std::lock_guard<std::mutex> cout_lock(cout_mutex);
-    std::shared_lock<std::shared_mutex> npc_lock(npcs_mutex);
+    NpcSnapshot snapshot;
+    take_snapshot(snapshot);
+    
+    // Итог по видам - из сетки плотности, без второго прохода по NPC
+    std::ostringstream by_species;
+    {
+        ensure_density();
+        std::shared_lock<std::shared_mutex> lock(density_mutex);
+        for (size_t t = 0; t < density.get_type_count(); ++t) {
+            NpcType type = static_cast<NpcType>(t);
+            by_species << (t == 0 ? "" : ", ") << species(type).display_name << ": "
+                       << density.count(type, world_bounds.min_x, world_bounds.min_y, world_bounds.max_x, world_bounds.max_y);
+        }
+    }
     
+    std::lock_guard<std::mutex> cout_lock(cout_mutex);
     std::cout << "\n=== SURVIVORS ===\n";
     int count = 0;
-    for (const auto& npc : npcs) {
+    for (const auto& npc : snapshot.npcs) {
         if (npc && npc->is_alive()) {
-            std::cout << npc->info() << "\n";
+            npc->print_info(std::cout);
+            std::cout << "\n";
             count++;
         }
     }
@@ -413,6 +1208,7 @@ void Game::print_survivors() {
         std::cout << "No survivors!\n";
     } else {
         std::cout << "Total survivors: " << count << "\n";
+        std::cout << "In the world by species: " << by_species.str() << "\n";
     }
 }
 
@@ -423,4 +1219,26 @@ int Game::get_alive_count() const {
         if (npc && npc->is_alive()) count++;
     }
     return count;
-}
\ No newline at end of file
+}
+
+bool Game::contains(NpcHandle handle) const {
+    std::shared_lock<std::shared_mutex> lock(npcs_mutex);
+    auto* npc = npcs.get(handle);
+    return npc && (*npc)->is_alive();
+}
+
+std::shared_ptr<INpc> Game::get_npc(NpcHandle handle) const {
+    std::shared_lock<std::shared_mutex> lock(npcs_mutex);
+    auto* npc = npcs.get(handle);
+    return npc ? *npc : nullptr;
+}
+
+std::vector<NpcHandle> Game::get_handles() const {
+    std::shared_lock<std::shared_mutex> lock(npcs_mutex);
+    std::vector<NpcHandle> handles;
+    handles.reserve(npcs.size());
+    for (size_t i = 0; i < npcs.size(); ++i) {
+        handles.push_back(npcs.handle_at(i));
+    }
+    return handles;
+}
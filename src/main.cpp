@@ -1,10 +1,16 @@
 #include "../include/game.h"
 #include "../include/constants.h"
+#include "../include/species.h"
 #include <iostream>
 #include <chrono>
 #include <thread>
 #include <string>
+#include <cstdlib>
+#include <algorithm>
 #include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
 
 using namespace std::chrono_literals;
 
@@ -19,24 +25,58 @@ void print_help() {
     std::cout << "| 2 - List NPCs                        |\n";
     std::cout << "| 3 - Save to file                     |\n";
     std::cout << "| 4 - Load from file                   |\n";
+    std::cout << "| i - Import NPC list (type name x y)  |\n";
     std::cout << "| 5 - Start battle (editor mode)       |\n";
     std::cout << "| 6 - Initialize game (50 NPCs)        |\n";
     std::cout << "| 7 - Start auto-battle (30 seconds)   |\n";
     std::cout << "| 8 - Print map                        |\n";
     std::cout << "| 9 - Print survivors                  |\n";
+    std::cout << "| m - Toggle movement (random/seek)    |\n";
+    std::cout << "| l - Toggle live map                  |\n";
+    std::cout << "| v - Set map viewport                 |\n";
+    std::cout << "| z/x - Zoom map in/out                |\n";
+    std::cout << "| d - Toggle map layer (types/density) |\n";
+    std::cout << "| r - Soak run (respawn to target mix) |\n";
+    std::cout << "| p - Dump tick phase timings          |\n";
     std::cout << "| 0 - Exit                             |\n";
     std::cout << "| h - Help                             |\n";
     std::cout << "+========================================+\n";
 }
 
+// Список для импорта: строка "<вид> <основа_имени> <x> <y>", '#' - комментарий.
+// Нечитаемые строки и строки с неизвестным видом пропускаются и считаются в skipped.
+std::vector<NpcSpec> read_npc_list(const std::string& filename, size_t& skipped) {
+    std::ifstream in(filename);
+    if (!in) {
+        throw std::runtime_error("Cannot open " + filename);
+    }
+    std::vector<NpcSpec> specs;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string type_name;
+        NpcSpec spec;
+        if (!(fields >> type_name >> spec.base_name >> spec.x >> spec.y) ||
+            !SpeciesRegistry::instance().find(type_name, spec.type)) {
+            ++skipped;
+            continue;
+        }
+        specs.push_back(std::move(spec));
+    }
+    return specs;
+}
+
 NpcType select_npc_type() {
+    const auto& registry = SpeciesRegistry::instance();
     int choice;
     while (true) {
         std::cout << "\nSelect NPC type:\n";
         std::cout << "+-----------------+\n";
-        std::cout << "| 1. Dragon       |\n";
-        std::cout << "| 2. Frog         |\n";
-        std::cout << "| 3. Bull         |\n";
+        for (size_t i = 0; i < registry.size(); ++i) {
+            std::cout << "| " << std::setw(2) << i + 1 << ". " << std::left << std::setw(11)
+                      << registry.get(static_cast<NpcType>(i)).traits.display_name << std::right << "|\n";
+        }
         std::cout << "+-----------------+\n";
         std::cout << "Choice: ";
         std::cin >> choice;
@@ -48,17 +88,33 @@ NpcType select_npc_type() {
             continue;
         }
         
-        switch (choice) {
-            case 1: return NpcType::DRAGON;
-            case 2: return NpcType::FROG;
-            case 3: return NpcType::BULL;
-            default: std::cout << "Invalid choice\n";
+        if (choice >= 1 && static_cast<size_t>(choice) <= registry.size()) {
+            return static_cast<NpcType>(choice - 1);
         }
+        std::cout << "Invalid choice\n";
     }
 }
 
-int main() {
-    Game game;
+// balagur_fate [ширина высота] - размер мира для авто-боя
+int main(int argc, char** argv) {
+    try {
+        if (SpeciesRegistry::instance().load_from_file(SPECIES_CONFIG_FILE)) {
+            std::cout << "Loaded " << SpeciesRegistry::instance().size()
+                      << " species from " << SPECIES_CONFIG_FILE << "\n";
+        }
+    } catch (const std::exception& e) {
+        std::cout << "Error: " << e.what() << "\nUsing built-in species\n";
+        SpeciesRegistry::instance().load_defaults();
+    }
+
+    GameConfig world = WORLD_BOUNDS;
+    if (argc >= 3) {
+        world.max_x = world.min_x + std::max(1, std::atoi(argv[1])) - 1;
+        world.max_y = world.min_y + std::max(1, std::atoi(argv[2])) - 1;
+        std::cout << "World size: " << world.width() << "x" << world.height() << "\n";
+    }
+
+    Game game(world);
     std::string filename = "dungeon.txt";
     
     std::cout << "+==============================================================+\n";
@@ -85,9 +141,10 @@ int main() {
                     std::cout << "Enter base name: ";
                     std::cin >> base_name;
                     int x, y;
-                    std::cout << "Enter X coordinate [0-500]: ";
+                    const GameConfig& bounds = game.get_editor_bounds();
+                    std::cout << "Enter X coordinate [" << bounds.min_x << "-" << bounds.max_x << "]: ";
                     std::cin >> x;
-                    std::cout << "Enter Y coordinate [0-500]: ";
+                    std::cout << "Enter Y coordinate [" << bounds.min_y << "-" << bounds.max_y << "]: ";
                     std::cin >> y;
                     game.add_npc(type, base_name, x, y);
                     break;
@@ -101,6 +158,20 @@ int main() {
                 case '4':
                     game.load_from_file(filename);
                     break;
+                case 'i': {
+                    std::string list_file;
+                    std::cout << "Enter NPC list file: ";
+                    std::cin >> list_file;
+                    size_t skipped = 0;
+                    AddNpcsSummary summary = game.add_npcs(read_npc_list(list_file, skipped));
+                    std::cout << "Imported " << summary.added << " of " << summary.requested + skipped << " NPCs";
+                    if (summary.out_of_bounds + summary.failed + skipped > 0) {
+                        std::cout << " (" << summary.out_of_bounds << " out of bounds, " << summary.failed
+                                  << " failed, " << skipped << " unreadable lines)";
+                    }
+                    std::cout << "\n";
+                    break;
+                }
                 case '5': {
                     int range;
                     std::cout << "Enter battle range: ";
@@ -143,7 +214,85 @@ int main() {
                 case '9':
                     game.print_survivors();
                     break;
+                case 'm': {
+                    bool seek = game.get_movement_mode() == MovementMode::RANDOM;
+                    game.set_movement_mode(seek ? MovementMode::SEEK_PREY : MovementMode::RANDOM);
+                    std::cout << "Movement: " << (seek ? "predators seek nearest prey" : "random") << "\n";
+                    break;
+                }
+                case 'l':
+                    if (game.is_live_map_running()) {
+                        game.stop_live_map();
+                        std::cout << "\nLive map stopped (" << game.get_frames_rendered() << " frames, "
+                                  << game.get_frames_dropped() << " dropped)\n";
+                    } else {
+                        game.start_live_map();
+                    }
+                    break;
+                case 'v': {
+                    int min_x, min_y, max_x, max_y;
+                    std::cout << "Enter viewport min X, min Y, max X, max Y: ";
+                    std::cin >> min_x >> min_y >> max_x >> max_y;
+                    game.set_map_viewport({min_x, max_x, min_y, max_y});
+                    break;
+                }
+                case 'z':
+                case 'x': {
+                    // Окно вдвое меньше или больше вокруг того же центра
+                    GameConfig view = game.get_map_viewport();
+                    int64_t center_x = (static_cast<int64_t>(view.min_x) + view.max_x) / 2;
+                    int64_t center_y = (static_cast<int64_t>(view.min_y) + view.max_y) / 2;
+                    int64_t half_w = command == 'z' ? std::max<int64_t>(1, view.width() / 4) : view.width();
+                    int64_t half_h = command == 'z' ? std::max<int64_t>(1, view.height() / 4) : view.height();
+                    const GameConfig& world = game.get_world_bounds();
+                    GameConfig zoomed;
+                    zoomed.min_x = static_cast<int>(std::max<int64_t>(world.min_x, center_x - half_w));
+                    zoomed.max_x = static_cast<int>(std::min<int64_t>(world.max_x, center_x + half_w));
+                    zoomed.min_y = static_cast<int>(std::max<int64_t>(world.min_y, center_y - half_h));
+                    zoomed.max_y = static_cast<int>(std::min<int64_t>(world.max_y, center_y + half_h));
+                    game.set_map_viewport(zoomed);
+                    game.print_map();
+                    break;
+                }
+                case 'd': {
+                    bool density = game.get_map_layer() == MapLayer::TYPES;
+                    game.set_map_layer(density ? MapLayer::DENSITY : MapLayer::TYPES);
+                    std::cout << "Map layer: " << (density ? "density" : "types") << "\n";
+                    break;
+                }
+                case 'r': {
+                    // Население держится у цели, журнал боёв ротируется; каждую
+                    // секунду - тики в секунду и число живых
+                    size_t per_type = 0;
+                    int seconds = 0;
+                    std::cout << "Target NPCs per species: ";
+                    std::cin >> per_type;
+                    std::cout << "Duration in seconds: ";
+                    std::cin >> seconds;
+                    game.set_population_target(std::vector<size_t>(SpeciesRegistry::instance().size(), per_type));
+                    game.set_log_rotation(LOG_ROTATE_BYTES, LOG_ROTATE_FILES);
+                    game.start();
+                    size_t printed = 0;
+                    for (int i = 0; i < seconds; ++i) {
+                        std::this_thread::sleep_for(1s);
+                        auto history = game.get_tick_rate_history();
+                        for (; printed < history.size(); ++printed) {
+                            std::cout << "[" << std::fixed << std::setprecision(0) << history[printed].seconds << "s] "
+                                      << std::setprecision(1) << history[printed].ticks_per_second << " ticks/s, "
+                                      << history[printed].alive << " alive\n";
+                        }
+                    }
+                    game.stop();
+                    game.set_population_target({});
+                    std::cout << "Respawned " << game.get_respawn_count() << " NPCs\n";
+                    game.print_survivors();
+                    break;
+                }
+                case 'p':
+                    game.print_phase_profile();
+                    break;
                 case '0':
+                    game.stop_live_map();
                     game.stop();
                     std::cout << "\nGoodbye!\n";
                     return 0;
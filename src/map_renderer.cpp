@@ -0,0 +1,124 @@
+#include "map_renderer.h"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Разрыв короче этого дешевле дописать символами, чем начать новую ESC-последовательность
+const int MIN_GAP_FOR_JUMP = 6;
+
+void move_cursor(std::string& out, int row, int column) {
+    out += "\x1b[";
+    out += std::to_string(row + 1);
+    out += ';';
+    out += std::to_string(column + 1);
+    out += 'H';
+}
+
+}
+
+void FrameBuffer::resize(int new_width, int new_height) {
+    width = std::max(0, new_width);
+    height = std::max(0, new_height);
+    cells.assign(static_cast<size_t>(width) * height, ' ');
+}
+
+void FrameBuffer::put_text(int row, int column, std::string_view text) {
+    if (row < 0 || row >= height || column >= width) return;
+    size_t count = std::min(text.size(), static_cast<size_t>(width - column));
+    std::copy_n(text.begin(), count, cells.begin() + static_cast<size_t>(row) * width + column);
+}
+
+std::string MapRenderer::plain(const FrameBuffer& frame) {
+    std::string out;
+    out.reserve(static_cast<size_t>(frame.get_width() + 1) * frame.get_height());
+    for (int y = 0; y < frame.get_height(); ++y) {
+        std::string_view line = frame.row(y);
+        // Хвостовые пробелы в прокручиваемом выводе не нужны
+        size_t end = line.find_last_not_of(' ');
+        out.append(line.substr(0, end == std::string_view::npos ? 0 : end + 1));
+        out += '\n';
+    }
+    return out;
+}
+
+std::string MapRenderer::full(const FrameBuffer& frame) {
+    std::string out = "\x1b[H\x1b[2J";
+    out.reserve(out.size() + static_cast<size_t>(frame.get_width() + 2) * frame.get_height());
+    for (int y = 0; y < frame.get_height(); ++y) {
+        out.append(frame.row(y));
+        out += "\r\n";
+    }
+    return out;
+}
+
+std::string MapRenderer::diff(const FrameBuffer& before, const FrameBuffer& after, size_t* changed) {
+    std::string out;
+    size_t cells = 0;
+    for (int y = 0; y < after.get_height(); ++y) {
+        std::string_view old_row = before.row(y);
+        std::string_view new_row = after.row(y);
+        int x = 0;
+        int width = after.get_width();
+        while (x < width) {
+            if (old_row[x] == new_row[x]) {
+                ++x;
+                continue;
+            }
+            // Участок изменений; короткие совпадающие разрывы внутри него переписываются
+            int begin = x;
+            int end = x + 1;
+            int scan = end;
+            while (scan < width && scan - end < MIN_GAP_FOR_JUMP) {
+                if (old_row[scan] != new_row[scan]) end = scan + 1;
+                ++scan;
+            }
+            move_cursor(out, y, begin);
+            out.append(new_row.substr(begin, end - begin));
+            cells += static_cast<size_t>(end - begin);
+            x = end;
+        }
+    }
+    if (changed) *changed = cells;
+    return out;
+}
+
+std::string MapRenderer::next(const FrameBuffer& frame) {
+    bool same_size = has_previous && previous.get_width() == frame.get_width() &&
+                     previous.get_height() == frame.get_height();
+    std::string out;
+    if (!same_size || (full_redraw_frames > 0 && frames_since_full + 1 >= full_redraw_frames)) {
+        out = full(frame);
+        changed_cells = frame.data().size();
+        frames_since_full = 0;
+    } else {
+        out = diff(previous, frame, &changed_cells);
+        ++frames_since_full;
+    }
+    previous = frame;
+    has_previous = true;
+    return out;
+}
+
+void write_to_terminal(const std::string& text) {
+    std::cout.flush();
+    std::fflush(stdout);
+#if defined(__unix__) || defined(__APPLE__)
+    const char* data = text.data();
+    size_t left = text.size();
+    while (left > 0) {
+        ssize_t written = ::write(STDOUT_FILENO, data, left);
+        if (written <= 0) break;
+        data += written;
+        left -= static_cast<size_t>(written);
+    }
+#else
+    std::fwrite(text.data(), 1, text.size(), stdout);
+    std::fflush(stdout);
+#endif
+}
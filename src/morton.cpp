@@ -0,0 +1,45 @@
+#include "morton.h"
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Коды считаются от угла блока, чтобы отрицательные координаты не ломали порядок
+template <class CodeOf>
+void for_each_code(const PositionBlock& positions, CodeOf&& code_of) {
+    if (positions.size() == 0) return;
+    int64_t min_x = *std::min_element(positions.xs.begin(), positions.xs.end());
+    int64_t min_y = *std::min_element(positions.ys.begin(), positions.ys.end());
+    for (size_t i = 0; i < positions.size(); ++i) {
+        code_of(i, static_cast<uint32_t>(positions.xs[i] - min_x), static_cast<uint32_t>(positions.ys[i] - min_y));
+    }
+}
+
+}
+
+std::vector<uint32_t> morton_order(const PositionBlock& positions) {
+    std::vector<std::pair<uint64_t, uint32_t>> keyed(positions.size());
+    for_each_code(positions, [&](size_t i, uint32_t x, uint32_t y) {
+        keyed[i] = {morton_code(x, y), static_cast<uint32_t>(i)};
+    });
+    std::sort(keyed.begin(), keyed.end());
+
+    std::vector<uint32_t> order(keyed.size());
+    for (size_t k = 0; k < keyed.size(); ++k) {
+        order[k] = keyed[k].second;
+    }
+    return order;
+}
+
+double morton_disorder(const PositionBlock& positions, int cell_size) {
+    if (positions.size() < 2) return 0.0;
+    uint32_t cell = static_cast<uint32_t>(cell_size > 0 ? cell_size : 1);
+    size_t descents = 0;
+    uint64_t previous = 0;
+    for_each_code(positions, [&](size_t i, uint32_t x, uint32_t y) {
+        uint64_t code = morton_code(x / cell, y / cell);
+        if (i > 0 && code < previous) ++descents;
+        previous = code;
+    });
+    return static_cast<double>(descents) / static_cast<double>(positions.size() - 1);
+}
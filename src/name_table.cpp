@@ -0,0 +1,99 @@
+#include "name_table.h"
+#include <mutex>
+
+namespace {
+
+const size_t MAX_ORDINAL_DIGITS = 9;
+
+// Отделяет числовой суффикс без ведущего нуля: "Frog123" -> ("Frog", 123).
+// Разбиение однозначно, поэтому одно и то же имя всегда даёт один NameId.
+uint32_t split_ordinal(std::string_view& full_name) {
+    size_t pos = full_name.size();
+    while (pos > 0 && full_name[pos - 1] >= '0' && full_name[pos - 1] <= '9') {
+        --pos;
+    }
+
+    size_t digits = full_name.size() - pos;
+    if (pos == 0 || digits == 0 || digits > MAX_ORDINAL_DIGITS || full_name[pos] == '0') {
+        return 0;
+    }
+
+    uint32_t ordinal = 0;
+    for (size_t i = pos; i < full_name.size(); ++i) {
+        ordinal = ordinal * 10 + static_cast<uint32_t>(full_name[i] - '0');
+    }
+    full_name = full_name.substr(0, pos);
+    return ordinal;
+}
+
+}
+
+NameTable::NameTable() {
+    intern("");
+}
+
+NameTable& NameTable::instance() {
+    static NameTable table;
+    return table;
+}
+
+uint32_t NameTable::intern(std::string_view str) {
+    // Номера строк не меняются, поэтому поток помнит найденные без замка таблицы;
+    // кэш сбрасывается целиком, чтобы не расти без предела
+    // (ключи - виды строк самой таблицы, они не перемещаются)
+    thread_local std::unordered_map<std::string_view, uint32_t> cache;
+    auto cached = cache.find(str);
+    if (cached != cache.end()) return cached->second;
+    if (cache.size() >= THREAD_CACHE_LIMIT) cache.clear();
+    uint32_t id = intern_shared(str);
+    cache.emplace(view(id), id);
+    return id;
+}
+
+uint32_t NameTable::intern_shared(std::string_view str) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = index.find(str);
+        if (it != index.end()) return it->second;
+    }
+
+    std::lock_guard<std::shared_mutex> lock(mutex);
+    auto it = index.find(str);
+    if (it != index.end()) return it->second;
+
+    auto id = static_cast<uint32_t>(strings.size());
+    strings.emplace_back(str);
+    index.emplace(strings.back(), id);
+    return id;
+}
+
+std::string_view NameTable::view(uint32_t id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return id < strings.size() ? std::string_view(strings[id]) : std::string_view();
+}
+
+size_t NameTable::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return strings.size();
+}
+
+NameId NameTable::make_name(std::string_view full_name) {
+    uint32_t ordinal = split_ordinal(full_name);
+    return {intern(full_name), ordinal};
+}
+
+std::string NameTable::format(const NameId& name) const {
+    std::string result(view(name.base));
+    if (name.ordinal != 0) {
+        result += std::to_string(name.ordinal);
+    }
+    return result;
+}
+
+std::ostream& operator<<(std::ostream& os, const NameId& name) {
+    os << NameTable::instance().view(name.base);
+    if (name.ordinal != 0) {
+        os << name.ordinal;
+    }
+    return os;
+}
@@ -0,0 +1,56 @@
+#include "npc_graveyard.h"
+#include <algorithm>
+
+void NpcPin::reset() {
+    if (owner) {
+        std::exchange(owner, nullptr)->unpin(epoch);
+    }
+}
+
+NpcPin NpcGraveyard::pin() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++pins[epoch];
+    return NpcPin(this, epoch);
+}
+
+void NpcGraveyard::unpin(uint64_t pin_epoch) {
+    std::vector<std::shared_ptr<BaseNpc>> freed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pins.find(pin_epoch);
+        if (it == pins.end()) return;
+        if (--it->second > 0) return;
+        pins.erase(it);
+        collect(freed);
+    }
+}
+
+void NpcGraveyard::bury(std::vector<std::shared_ptr<BaseNpc>>& npcs) {
+    std::vector<std::shared_ptr<BaseNpc>> freed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& npc : npcs) {
+            buried.emplace_back(epoch, std::move(npc));
+        }
+        // Метки, взятые после этого, уже не видят похороненных
+        ++epoch;
+        collect(freed);
+    }
+    npcs.clear();
+}
+
+size_t NpcGraveyard::buried_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return buried.size();
+}
+
+void NpcGraveyard::collect(std::vector<std::shared_ptr<BaseNpc>>& freed) {
+    uint64_t oldest = pins.empty() ? epoch : pins.begin()->first;
+    auto keep = std::stable_partition(buried.begin(), buried.end(), [&](const auto& grave) {
+        return grave.first >= oldest;
+    });
+    for (auto it = keep; it != buried.end(); ++it) {
+        freed.push_back(std::move(it->second));
+    }
+    buried.erase(keep, buried.end());
+}
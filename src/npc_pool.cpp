@@ -0,0 +1,106 @@
+#include "npc_pool.h"
+#include <algorithm>
+#include <new>
+
+namespace {
+
+const size_t SLOT_ALIGNMENT = alignof(std::max_align_t);
+
+size_t round_up(size_t bytes) {
+    return (bytes + SLOT_ALIGNMENT - 1) / SLOT_ALIGNMENT * SLOT_ALIGNMENT;
+}
+
+}
+
+PoolStats& PoolStats::operator+=(const PoolStats& other) {
+    slot_allocations += other.slot_allocations;
+    slot_reuses += other.slot_reuses;
+    block_allocations += other.block_allocations;
+    fallback_allocations += other.fallback_allocations;
+    live_slots += other.live_slots;
+    reserved_slots += other.reserved_slots;
+    return *this;
+}
+
+NpcPool::NpcPool(size_t slots_per_block) : slots_per_block(slots_per_block ? slots_per_block : 1) {}
+
+NpcPool::~NpcPool() {
+    for (void* block : blocks) {
+        ::operator delete(block);
+    }
+}
+
+void NpcPool::grow() {
+    auto* block = static_cast<char*>(::operator new(slot_size * slots_per_block));
+    blocks.push_back(block);
+    stats.block_allocations++;
+    stats.reserved_slots += slots_per_block;
+
+    bump = block;
+    bump_left = slots_per_block;
+}
+
+void* NpcPool::allocate(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (slot_size == 0) {
+        slot_size = round_up(std::max(bytes, sizeof(FreeSlot)));
+    }
+
+    if (bytes > slot_size) {
+        stats.fallback_allocations++;
+        return ::operator new(bytes);
+    }
+
+    void* slot;
+    if (free_list) {
+        slot = free_list;
+        free_list = free_list->next;
+        stats.slot_reuses++;
+    } else {
+        if (bump_left == 0) {
+            grow();
+        }
+        slot = bump;
+        bump += slot_size;
+        bump_left--;
+    }
+
+    stats.slot_allocations++;
+    stats.live_slots++;
+    return slot;
+}
+
+void NpcPool::deallocate(void* ptr, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (bytes > slot_size) {
+        ::operator delete(ptr);
+        return;
+    }
+
+    auto* slot = static_cast<FreeSlot*>(ptr);
+    slot->next = free_list;
+    free_list = slot;
+    stats.live_slots--;
+}
+
+bool NpcPool::release() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stats.live_slots != 0) return false;
+
+    for (void* block : blocks) {
+        ::operator delete(block);
+    }
+    blocks.clear();
+    free_list = nullptr;
+    bump = nullptr;
+    bump_left = 0;
+    stats.reserved_slots = 0;
+    return true;
+}
+
+PoolStats NpcPool::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
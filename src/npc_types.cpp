@@ -1,70 +1,59 @@
 #include "npc_types.h"
-#include <cmath>
-#include <stdexcept>
 #include <chrono>
 #include <sstream>
 
-BaseNpc::BaseNpc(NpcType type, const std::string& name, int x, int y) 
-    : position{x, y}, name(name), type(type) {
-    auto seed = static_cast<unsigned int>(
+BaseNpc::BaseNpc(NpcType type, const std::string& name, int x, int y)
+    : BaseNpc(type, NameTable::instance().make_name(name), x, y) {}
+
+namespace {
+
+// Счётчик разводит зерна NPC, созданных в один и тот же тик часов. Он свой
+// у каждого потока (общий атомарный счётчик - одна строка кэша на всех
+// создающих), а потоки разведены номером, взятым один раз
+uint32_t next_rng_seed() {
+    static std::atomic<uint32_t> threads{0};
+    thread_local uint32_t counter = threads.fetch_add(1) * 0x6C8E9CF5u;
+    auto seed = static_cast<uint32_t>(
         std::chrono::steady_clock::now().time_since_epoch().count());
-    rng.seed(seed);
+    return seed ^ (counter++ * 0x9E3779B9u);
 }
 
-Position BaseNpc::get_position() const { return position; }
-std::string BaseNpc::get_name() const { return name; }
-NpcType BaseNpc::get_type() const { return type; }
+}
 
-bool BaseNpc::is_alive() const { return alive.load(); }
+BaseNpc::BaseNpc(NpcType type, NameId name, int x, int y)
+    : BaseNpc(type, name, x, y, next_rng_seed()) {}
 
-void BaseNpc::kill() { 
-    alive.store(false); 
-}
+// Зерно от вызывающего: без общего счётчика и часов, воспроизводимо
+BaseNpc::BaseNpc(NpcType type, NameId name, int x, int y, uint32_t rng_seed)
+    : position(Position{x, y}), name(name), type(type), rng(rng_seed) {}
 
-MovementConfig BaseNpc::get_movement_config() const {
-    switch(type) {
-        case NpcType::DRAGON: return DRAGON_CONFIG;
-        case NpcType::FROG: return FROG_CONFIG;
-        case NpcType::BULL: return BULL_CONFIG;
-        default: return {0, 0};
-    }
+BaseNpc::BaseNpc(NpcType type, std::istream& is) : BaseNpc(type, NameId{}, 0, 0) {
+    read_body(is);
 }
 
-int BaseNpc::roll_dice() const {
-    std::uniform_int_distribution<int> dist(1, DICE_SIDES);
-    return dist(rng);
-}
+std::string BaseNpc::get_name() const { return NameTable::instance().format(name); }
 
-std::string BaseNpc::get_type_str() const {
-    switch(type) {
-        case NpcType::DRAGON: return "dragon";
-        case NpcType::FROG: return "frog";
-        case NpcType::BULL: return "bull";
-        default: return "unknown";
-    }
+std::string BaseNpc::info() const {
+    std::ostringstream os;
+    print_info(os);
+    return os.str();
 }
 
-std::string BaseNpc::info() const {
-    return get_type_str() + " \"" + name + "\" " + position.to_string() +
-           (alive.load() ? "" : " [DEAD]");
+void BaseNpc::print_info(std::ostream& os) const {
+    Position pos = get_position();
+    os << get_type_str() << " \"" << name << "\" (" << pos.x << ", " << pos.y << ")";
+    if (!alive.load()) {
+        os << " [DEAD]";
+    }
 }
 
 bool BaseNpc::accept(const std::shared_ptr<IVisitor>& visitor) {
     return visitor ? visitor->visit(shared_from_this()) : false;
 }
 
-void BaseNpc::move() {
-    if (!alive.load()) return;
-    specific_move();
-
-    if (!position.is_within_game_bounds()) {
-        position.x = std::max(0, std::min(position.x, MAP_WIDTH - 1));
-        position.y = std::max(0, std::min(position.y, MAP_HEIGHT - 1));
-    }
-}
-
 void BaseNpc::save(std::ostream& os) const {
-    os << get_type_str() << " " << position.x << " " << position.y << " \"" << name << "\"";
+    Position pos = get_position();
+    os << get_type_str() << " " << pos.x << " " << pos.y << " \"" << name << "\"";
 }
 
 void BaseNpc::subscribe(const std::shared_ptr<IObserver>& observer) {
@@ -81,45 +70,31 @@ void BaseNpc::notify_kill(const std::shared_ptr<INpc>& victim) {
     }
 }
 
-void BaseNpc::specific_move() {
-
-}
-
-Dragon::Dragon(const std::string& name, int x, int y) : BaseNpc(NpcType::DRAGON, name, x, y) {}
-
-Dragon::Dragon(std::istream& is) : BaseNpc(NpcType::DRAGON, "", 0, 0) {
-    is >> position.x >> position.y;
+void BaseNpc::read_body(std::istream& is) {
+    Position pos{0, 0};
+    is >> pos.x >> pos.y;
+    position.store(pos, std::memory_order_relaxed);
     char quote;
     is >> std::ws >> quote;
-    std::getline(is, name, '"');
+    std::string full_name;
+    std::getline(is, full_name, '"');
+    name = NameTable::instance().make_name(full_name);
 }
 
-void Dragon::specific_move() {
-    position.random_move(DRAGON_CONFIG.move_distance);
-}
+Dragon::Dragon(const std::string& name, int x, int y) : BaseNpc(NpcType::DRAGON, name, x, y) {}
+Dragon::Dragon(NameId name, int x, int y) : BaseNpc(NpcType::DRAGON, name, x, y) {}
+Dragon::Dragon(NameId name, int x, int y, uint32_t rng_seed) : BaseNpc(NpcType::DRAGON, name, x, y, rng_seed) {}
 
-Frog::Frog(const std::string& name, int x, int y) : BaseNpc(NpcType::FROG, name, x, y) {}
+Dragon::Dragon(std::istream& is) : BaseNpc(NpcType::DRAGON, is) {}
 
-Frog::Frog(std::istream& is) : BaseNpc(NpcType::FROG, "", 0, 0) {
-    is >> position.x >> position.y;
-    char quote;
-    is >> std::ws >> quote;
-    std::getline(is, name, '"');
-}
+Frog::Frog(const std::string& name, int x, int y) : BaseNpc(NpcType::FROG, name, x, y) {}
+Frog::Frog(NameId name, int x, int y) : BaseNpc(NpcType::FROG, name, x, y) {}
+Frog::Frog(NameId name, int x, int y, uint32_t rng_seed) : BaseNpc(NpcType::FROG, name, x, y, rng_seed) {}
 
-void Frog::specific_move() {
-    position.random_move(FROG_CONFIG.move_distance);
-}
+Frog::Frog(std::istream& is) : BaseNpc(NpcType::FROG, is) {}
 
 Bull::Bull(const std::string& name, int x, int y) : BaseNpc(NpcType::BULL, name, x, y) {}
+Bull::Bull(NameId name, int x, int y) : BaseNpc(NpcType::BULL, name, x, y) {}
+Bull::Bull(NameId name, int x, int y, uint32_t rng_seed) : BaseNpc(NpcType::BULL, name, x, y, rng_seed) {}
 
-Bull::Bull(std::istream& is) : BaseNpc(NpcType::BULL, "", 0, 0) {
-    is >> position.x >> position.y;
-    char quote;
-    is >> std::ws >> quote;
-    std::getline(is, name, '"');
-}
-
-void Bull::specific_move() {
-    position.random_move(BULL_CONFIG.move_distance);
-}
\ No newline at end of file
+Bull::Bull(std::istream& is) : BaseNpc(NpcType::BULL, is) {}
@@ -1,29 +1,92 @@
 #include "observer.h"
+#include <cstdio>
 #include <ctime>
+#include <sstream>
 
-void ConsoleObserver::on_kill(const std::shared_ptr<INpc>& killer, const std::shared_ptr<INpc>& victim) {
+namespace {
+
+std::tm local_time_now() {
+    auto time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::tm tm{};
+#ifdef _WIN32
+    localtime_s(&tm, &time);
+#else
+    localtime_r(&time, &tm);
+#endif
+    return tm;
+}
+
+}
+
+void ConsoleObserver::log(const NameId& killer, const NameId& victim) {
     std::lock_guard<std::mutex> lock(mutex);
+    std::tm tm = local_time_now();
+    std::cout << std::put_time(&tm, "[%H:%M:%S] ");
+    std::cout << "[KILL] " << killer << " killed " << victim << std::endl;
+}
+
+void ConsoleObserver::on_kill(const std::shared_ptr<INpc>& killer, const std::shared_ptr<INpc>& victim) {
     if (killer && victim) {
-        auto now = std::chrono::system_clock::now();
-        auto time = std::chrono::system_clock::to_time_t(now);
-        std::tm tm{};
-        localtime_s(&tm, &time);
-        std::cout << std::put_time(&tm, "[%H:%M:%S] ");
-        std::cout << "[KILL] " << killer->get_name() << " killed " << victim->get_name() << std::endl;
+        log(killer->get_name_id(), victim->get_name_id());
     }
 }
 
-void FileObserver::on_kill(const std::shared_ptr<INpc>& killer, const std::shared_ptr<INpc>& victim) {
+void ConsoleObserver::on_kill_event(const KillEvent& event) {
+    log(event.killer_name, event.victim_name);
+}
+
+void FileObserver::set_rotation(uintmax_t max_bytes, size_t keep_files) {
     std::lock_guard<std::mutex> lock(mutex);
-    if (killer && victim) {
-        std::ofstream file(filename, std::ios::app);
-        if (file.is_open()) {
-            auto now = std::chrono::system_clock::now();
-            auto time = std::chrono::system_clock::to_time_t(now);
-            std::tm tm{};
-            localtime_s(&tm, &time);
-            file << std::put_time(&tm, "[%Y-%m-%d %H:%M:%S] ");
-            file << killer->get_name() << " killed " << victim->get_name() << "\n";
+    this->max_bytes = max_bytes;
+    this->keep_files = keep_files;
+    size_known = false;
+}
+
+void FileObserver::rotate() {
+    if (keep_files == 0) {
+        std::remove(filename.c_str());
+    } else {
+        std::remove((filename + "." + std::to_string(keep_files)).c_str());
+        for (size_t i = keep_files - 1; i >= 1; --i) {
+            std::rename((filename + "." + std::to_string(i)).c_str(),
+                        (filename + "." + std::to_string(i + 1)).c_str());
         }
+        std::rename(filename.c_str(), (filename + ".1").c_str());
     }
-}
\ No newline at end of file
+    size = 0;
+}
+
+void FileObserver::log(const NameId& killer, const NameId& victim) {
+    std::ostringstream line;
+    std::tm tm = local_time_now();
+    line << std::put_time(&tm, "[%Y-%m-%d %H:%M:%S] ");
+    line << killer << " killed " << victim << "\n";
+    std::string text = line.str();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (max_bytes > 0) {
+        if (!size_known) {
+            std::ifstream existing(filename, std::ios::binary | std::ios::ate);
+            size = existing.is_open() ? static_cast<uintmax_t>(existing.tellg()) : 0;
+            size_known = true;
+        }
+        if (size > 0 && size + text.size() > max_bytes) {
+            rotate();
+        }
+    }
+    std::ofstream file(filename, std::ios::app);
+    if (file.is_open()) {
+        file << text;
+        size += text.size();
+    }
+}
+
+void FileObserver::on_kill(const std::shared_ptr<INpc>& killer, const std::shared_ptr<INpc>& victim) {
+    if (killer && victim) {
+        log(killer->get_name_id(), victim->get_name_id());
+    }
+}
+
+void FileObserver::on_kill_event(const KillEvent& event) {
+    log(event.killer_name, event.victim_name);
+}
@@ -0,0 +1,163 @@
+#include "phase_profiler.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+namespace {
+
+const char* const PHASE_NAMES[TICK_PHASE_COUNT] = {
+    "tick", "movement", "collisions", "queue_push", "queue_drain", "battle", "logging", "console", "cleanup",
+    "respawn"
+};
+
+// Набор потока возвращается в общий список, когда поток завершается
+struct ThreadSlot {
+    PhaseProfiler::ThreadHistograms* histograms = nullptr;
+    ~ThreadSlot() {
+        if (histograms) PhaseProfiler::instance().release(*histograms);
+    }
+};
+
+thread_local ThreadSlot thread_slot;
+
+uint64_t percentile(const std::vector<uint64_t>& counts, uint64_t total, double fraction) {
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * static_cast<double>(total) + 0.5));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < counts.size(); ++bucket) {
+        seen += counts[bucket];
+        if (seen >= rank) return PhaseHistogram::bucket_limit(bucket);
+    }
+    return 0;
+}
+
+std::string format_ns(uint64_t ns) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(ns < 10000 ? 0 : 1);
+    if (ns < 10000) {
+        out << ns << " ns";
+    } else if (ns < 10000000) {
+        out << ns / 1000.0 << " us";
+    } else {
+        out << ns / 1000000.0 << " ms";
+    }
+    return out.str();
+}
+
+}
+
+const char* phase_name(TickPhase phase) {
+    size_t index = static_cast<size_t>(phase);
+    return index < TICK_PHASE_COUNT ? PHASE_NAMES[index] : "unknown";
+}
+
+// Значения меньше SUB_BUCKETS - по корзине на значение; дальше корзина
+// задаётся старшим битом и следующими тремя
+size_t PhaseHistogram::bucket_of(uint64_t ns) {
+    if (ns < SUB_BUCKETS) return static_cast<size_t>(ns);
+    int msb = 63;
+    while (!(ns >> msb)) --msb;
+    size_t sub = static_cast<size_t>((ns >> (msb - 3)) & (SUB_BUCKETS - 1));
+    return static_cast<size_t>(msb - 2) * SUB_BUCKETS + sub;
+}
+
+uint64_t PhaseHistogram::bucket_limit(size_t bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+    int msb = static_cast<int>(bucket / SUB_BUCKETS) + 2;
+    uint64_t sub = bucket % SUB_BUCKETS;
+    uint64_t step = uint64_t(1) << (msb - 3);
+    return (SUB_BUCKETS + sub) * step + (step - 1);
+}
+
+void PhaseHistogram::add_to(std::vector<uint64_t>& counts, uint64_t& max) const {
+    for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+        counts[bucket] += buckets[bucket].load(std::memory_order_relaxed);
+    }
+    max = std::max(max, max_ns.load(std::memory_order_relaxed));
+}
+
+void PhaseHistogram::clear() {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    max_ns.store(0, std::memory_order_relaxed);
+}
+
+PhaseProfiler& PhaseProfiler::instance() {
+    static PhaseProfiler profiler;
+    return profiler;
+}
+
+PhaseProfiler::ThreadHistograms& PhaseProfiler::acquire() {
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    for (auto& histograms : threads) {
+        if (!histograms->in_use.load()) {
+            histograms->in_use = true;
+            return *histograms;
+        }
+    }
+    threads.push_back(std::make_unique<ThreadHistograms>());
+    threads.back()->in_use = true;
+    return *threads.back();
+}
+
+void PhaseProfiler::release(ThreadHistograms& histograms) {
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    histograms.in_use = false;
+}
+
+void PhaseProfiler::record(TickPhase phase, uint64_t ns) {
+    if (!thread_slot.histograms) {
+        thread_slot.histograms = &acquire();
+    }
+    thread_slot.histograms->phases[static_cast<size_t>(phase)].record(ns);
+}
+
+std::array<PhaseStats, TICK_PHASE_COUNT> PhaseProfiler::stats() const {
+    std::array<PhaseStats, TICK_PHASE_COUNT> result;
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    std::vector<uint64_t> counts(PhaseHistogram::BUCKETS);
+    for (size_t phase = 0; phase < TICK_PHASE_COUNT; ++phase) {
+        std::fill(counts.begin(), counts.end(), 0);
+        uint64_t max = 0;
+        for (const auto& histograms : threads) {
+            histograms->phases[phase].add_to(counts, max);
+        }
+        PhaseStats& stats = result[phase];
+        for (uint64_t count : counts) {
+            stats.count += count;
+        }
+        if (stats.count == 0) continue;
+        // Граница корзины может быть больше самого долгого замера
+        stats.p50_ns = std::min(percentile(counts, stats.count, 0.50), max);
+        stats.p99_ns = std::min(percentile(counts, stats.count, 0.99), max);
+        stats.max_ns = max;
+    }
+    return result;
+}
+
+// Сброс во время записи может потерять или оставить отдельные замеры
+void PhaseProfiler::reset() {
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    for (auto& histograms : threads) {
+        for (auto& phase : histograms->phases) {
+            phase.clear();
+        }
+    }
+}
+
+void PhaseProfiler::print(std::ostream& os) const {
+    auto all = stats();
+    os << std::left << std::setw(12) << "phase" << std::right << std::setw(10) << "count"
+       << std::setw(12) << "p50" << std::setw(12) << "p99" << std::setw(12) << "max" << "\n";
+    for (size_t phase = 0; phase < TICK_PHASE_COUNT; ++phase) {
+        const PhaseStats& stats = all[phase];
+        os << std::left << std::setw(12) << PHASE_NAMES[phase] << std::right << std::setw(10) << stats.count;
+        if (stats.count == 0) {
+            os << std::setw(12) << "-" << std::setw(12) << "-" << std::setw(12) << "-" << "\n";
+            continue;
+        }
+        os << std::setw(12) << format_ns(stats.p50_ns) << std::setw(12) << format_ns(stats.p99_ns)
+           << std::setw(12) << format_ns(stats.max_ns) << "\n";
+    }
+}
@@ -0,0 +1,390 @@
+#include "spatial_index.h"
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <utility>
+
+namespace {
+
+// Глубина не больше ~34 (сторона корня до 2^33), в стеке обхода - до трёх
+// отложенных братьев на уровень
+const size_t TRAVERSAL_STACK = 160;
+
+}
+
+QuadTree::QuadTree() {
+    clear();
+}
+
+void QuadTree::clear() {
+    nodes.assign(1, Node{});
+    free_groups.clear();
+    leaf_of.clear();
+    slot_of.clear();
+    item_count = 0;
+}
+
+uint32_t QuadTree::allocate_group(uint32_t parent) {
+    uint32_t group;
+    if (!free_groups.empty()) {
+        group = free_groups.back();
+        free_groups.pop_back();
+        for (uint32_t q = 0; q < 4; ++q) {
+            nodes[group + q] = Node{};
+        }
+    } else {
+        group = static_cast<uint32_t>(nodes.size());
+        nodes.resize(nodes.size() + 4);
+    }
+
+    const Node& owner = nodes[parent];
+    int64_t half = owner.size / 2;
+    for (uint32_t q = 0; q < 4; ++q) {
+        Node& child = nodes[group + q];
+        child.min_x = owner.min_x + (q & 1 ? half : 0);
+        child.min_y = owner.min_y + (q & 2 ? half : 0);
+        child.size = half;
+        child.parent = parent;
+    }
+    return group;
+}
+
+void QuadTree::free_subtree(uint32_t node) {
+    uint32_t group = nodes[node].first_child;
+    if (group == NONE) return;
+    for (uint32_t q = 0; q < 4; ++q) {
+        free_subtree(group + q);
+    }
+    free_groups.push_back(group);
+    nodes[node].first_child = NONE;
+}
+
+// Корень удваивается в сторону точки; старый корень становится одним из потомков
+void QuadTree::grow_to(int x, int y) {
+    while (!nodes[0].covers(x, y)) {
+        bool grow_left = x < nodes[0].min_x;
+        bool grow_down = y < nodes[0].min_y;
+        int64_t new_min_x = grow_left ? nodes[0].min_x - nodes[0].size : nodes[0].min_x;
+        int64_t new_min_y = grow_down ? nodes[0].min_y - nodes[0].size : nodes[0].min_y;
+
+        if (nodes[0].is_leaf()) {
+            nodes[0].min_x = new_min_x;
+            nodes[0].min_y = new_min_y;
+            nodes[0].size *= 2;
+            continue;
+        }
+
+        Node old_root = std::move(nodes[0]);
+        nodes[0] = Node{};
+        nodes[0].min_x = new_min_x;
+        nodes[0].min_y = new_min_y;
+        nodes[0].size = old_root.size * 2;
+        nodes[0].count = old_root.count;
+
+        uint32_t group = allocate_group(0);
+        uint32_t moved = group + (grow_left ? 1 : 0) + (grow_down ? 2 : 0);
+        old_root.parent = 0;
+        nodes[moved] = std::move(old_root);
+        for (uint32_t q = 0; q < 4; ++q) {
+            nodes[nodes[moved].first_child + q].parent = moved;
+        }
+        nodes[0].first_child = group;
+    }
+}
+
+uint32_t QuadTree::find_leaf(int x, int y) const {
+    uint32_t node = 0;
+    while (!nodes[node].is_leaf()) {
+        const Node& current = nodes[node];
+        int64_t half = current.size / 2;
+        node = current.first_child + (x >= current.min_x + half ? 1 : 0) + (y >= current.min_y + half ? 2 : 0);
+    }
+    return node;
+}
+
+void QuadTree::add_to_leaf(uint32_t leaf, uint32_t id, const Position& pos) {
+    Node& node = nodes[leaf];
+    leaf_of[id] = leaf;
+    slot_of[id] = static_cast<uint32_t>(node.ids.size());
+    node.ids.push_back(id);
+    node.points.push_back(pos);
+}
+
+void QuadTree::remove_from_leaf(uint32_t leaf, uint32_t slot) {
+    Node& node = nodes[leaf];
+    uint32_t last = static_cast<uint32_t>(node.ids.size() - 1);
+    if (slot != last) {
+        node.ids[slot] = node.ids[last];
+        node.points.xs[slot] = node.points.xs[last];
+        node.points.ys[slot] = node.points.ys[last];
+        slot_of[node.ids[slot]] = slot;
+    }
+    node.ids.pop_back();
+    node.points.xs.pop_back();
+    node.points.ys.pop_back();
+}
+
+void QuadTree::split(uint32_t leaf) {
+    uint32_t group = allocate_group(leaf);
+    std::vector<uint32_t> ids = std::move(nodes[leaf].ids);
+    PositionBlock points = std::move(nodes[leaf].points);
+    nodes[leaf].ids.clear();
+    nodes[leaf].points.clear();
+    nodes[leaf].first_child = group;
+
+    for (size_t k = 0; k < ids.size(); ++k) {
+        Position pos{points.xs[k], points.ys[k]};
+        uint32_t child = find_leaf(pos.x, pos.y);
+        add_to_leaf(child, ids[k], pos);
+        ++nodes[child].count;
+    }
+    // Все точки могли попасть в одного потомка; в квадрате 1x1 делить уже нечего
+    for (uint32_t q = 0; q < 4; ++q) {
+        if (nodes[group + q].count > LEAF_CAPACITY && nodes[group + q].size > 1) {
+            split(group + q);
+        }
+    }
+}
+
+void QuadTree::gather(uint32_t node, uint32_t into) {
+    if (nodes[node].is_leaf()) {
+        const Node& source = nodes[node];
+        for (size_t k = 0; k < source.ids.size(); ++k) {
+            add_to_leaf(into, source.ids[k], {source.points.xs[k], source.points.ys[k]});
+        }
+        return;
+    }
+    for (uint32_t q = 0; q < 4; ++q) {
+        gather(nodes[node].first_child + q, into);
+    }
+}
+
+void QuadTree::collapse(uint32_t node) {
+    if (nodes[node].is_leaf()) return;
+    // Точки пишутся в списки самого узла: у внутреннего узла они пусты
+    for (uint32_t q = 0; q < 4; ++q) {
+        gather(nodes[node].first_child + q, node);
+    }
+    free_subtree(node);
+}
+
+void QuadTree::build(const PositionBlock& positions) {
+    clear();
+    size_t count = positions.size();
+    if (count == 0) return;
+
+    int min_x = *std::min_element(positions.xs.begin(), positions.xs.end());
+    int max_x = *std::max_element(positions.xs.begin(), positions.xs.end());
+    int min_y = *std::min_element(positions.ys.begin(), positions.ys.end());
+    int max_y = *std::max_element(positions.ys.begin(), positions.ys.end());
+    int64_t span = std::max(static_cast<int64_t>(max_x) - min_x, static_cast<int64_t>(max_y) - min_y) + 1;
+    int64_t size = 1;
+    while (size < span) {
+        size *= 2;
+    }
+    nodes[0].min_x = min_x;
+    nodes[0].min_y = min_y;
+    nodes[0].size = size;
+
+    leaf_of.assign(count, NONE);
+    slot_of.assign(count, 0);
+    for (size_t i = 0; i < count; ++i) {
+        insert(static_cast<uint32_t>(i), {positions.xs[i], positions.ys[i]});
+    }
+}
+
+void QuadTree::insert(uint32_t id, const Position& pos) {
+    if (contains(id)) {
+        update(id, pos);
+        return;
+    }
+    if (id >= leaf_of.size()) {
+        leaf_of.resize(static_cast<size_t>(id) + 1, NONE);
+        slot_of.resize(static_cast<size_t>(id) + 1, 0);
+    }
+
+    grow_to(pos.x, pos.y);
+    uint32_t leaf = find_leaf(pos.x, pos.y);
+    add_to_leaf(leaf, id, pos);
+    for (uint32_t node = leaf; node != NONE; node = nodes[node].parent) {
+        ++nodes[node].count;
+    }
+    ++item_count;
+
+    if (nodes[leaf].count > LEAF_CAPACITY && nodes[leaf].size > 1) {
+        split(leaf);
+    }
+}
+
+bool QuadTree::erase(uint32_t id) {
+    if (!contains(id)) return false;
+
+    uint32_t leaf = leaf_of[id];
+    remove_from_leaf(leaf, slot_of[id]);
+    leaf_of[id] = NONE;
+    --item_count;
+
+    // Схлопывается самый верхний предок, в котором осталось мало точек
+    uint32_t highest = NONE;
+    for (uint32_t node = leaf; node != NONE; node = nodes[node].parent) {
+        --nodes[node].count;
+        if (!nodes[node].is_leaf() && nodes[node].count <= MERGE_THRESHOLD) {
+            highest = node;
+        }
+    }
+    if (highest != NONE) {
+        collapse(highest);
+    }
+    return true;
+}
+
+void QuadTree::update(uint32_t id, const Position& pos) {
+    if (!contains(id)) {
+        insert(id, pos);
+        return;
+    }
+    Node& leaf = nodes[leaf_of[id]];
+    if (leaf.covers(pos.x, pos.y)) {
+        leaf.points.xs[slot_of[id]] = pos.x;
+        leaf.points.ys[slot_of[id]] = pos.y;
+        return;
+    }
+    erase(id);
+    insert(id, pos);
+}
+
+size_t QuadTree::leaf_count() const {
+    size_t leaves = 0;
+    std::vector<uint32_t> pending{0};
+    while (!pending.empty()) {
+        uint32_t node = pending.back();
+        pending.pop_back();
+        if (nodes[node].is_leaf()) {
+            ++leaves;
+            continue;
+        }
+        for (uint32_t q = 0; q < 4; ++q) {
+            pending.push_back(nodes[node].first_child + q);
+        }
+    }
+    return leaves;
+}
+
+// visit(leaf, inside): inside - лист целиком внутри прямоугольника
+template <class Visit>
+void QuadTree::for_each_leaf(int64_t rect_min_x, int64_t rect_min_y, int64_t rect_max_x, int64_t rect_max_y,
+                             Visit&& visit) const {
+    if (item_count == 0 || rect_min_x > rect_max_x || rect_min_y > rect_max_y) return;
+
+    uint32_t stack[TRAVERSAL_STACK];
+    size_t depth = 0;
+    stack[depth++] = 0;
+    while (depth > 0) {
+        const Node& node = nodes[stack[--depth]];
+        int64_t node_max_x = node.min_x + node.size - 1;
+        int64_t node_max_y = node.min_y + node.size - 1;
+        if (node.count == 0 || node.min_x > rect_max_x || node_max_x < rect_min_x ||
+            node.min_y > rect_max_y || node_max_y < rect_min_y) {
+            continue;
+        }
+        if (node.is_leaf()) {
+            bool inside = node.min_x >= rect_min_x && node_max_x <= rect_max_x &&
+                          node.min_y >= rect_min_y && node_max_y <= rect_max_y;
+            visit(node, inside);
+            continue;
+        }
+        for (uint32_t q = 0; q < 4; ++q) {
+            stack[depth++] = node.first_child + q;
+        }
+    }
+}
+
+void QuadTree::query_radius(const Position& center, int range, std::vector<uint32_t>& out) const {
+    if (range < 0) return;
+
+    for_each_leaf(static_cast<int64_t>(center.x) - range, static_cast<int64_t>(center.y) - range,
+                  static_cast<int64_t>(center.x) + range, static_cast<int64_t>(center.y) + range,
+                  [&](const Node& leaf, bool) {
+        for_each_in_range(center, leaf.points, range, [&](size_t k) {
+            out.push_back(leaf.ids[k]);
+        });
+    });
+}
+
+void QuadTree::query_rect(int rect_min_x, int rect_min_y, int rect_max_x, int rect_max_y,
+                          std::vector<uint32_t>& out) const {
+    for_each_leaf(rect_min_x, rect_min_y, rect_max_x, rect_max_y, [&](const Node& leaf, bool inside) {
+        if (inside) {
+            out.insert(out.end(), leaf.ids.begin(), leaf.ids.end());
+            return;
+        }
+        for (size_t k = 0; k < leaf.ids.size(); ++k) {
+            if (leaf.points.xs[k] >= rect_min_x && leaf.points.xs[k] <= rect_max_x &&
+                leaf.points.ys[k] >= rect_min_y && leaf.points.ys[k] <= rect_max_y) {
+                out.push_back(leaf.ids[k]);
+            }
+        }
+    });
+}
+
+namespace {
+
+// Разности больше 2^31 ничего не решают, а квадраты от них переполнили бы int64
+int64_t axis_gap(int64_t gap) {
+    return std::min<int64_t>(gap, INT32_MAX);
+}
+
+}
+
+void QuadTree::nearest(const Position& center, size_t k, std::vector<Neighbour>& out,
+                       int64_t max_distance_sq) const {
+    out.clear();
+    if (k == 0 || item_count == 0) return;
+
+    auto box_distance = [&](const Node& node) {
+        int64_t dx = axis_gap(std::max<int64_t>({node.min_x - center.x, 0, center.x - (node.min_x + node.size - 1)}));
+        int64_t dy = axis_gap(std::max<int64_t>({node.min_y - center.y, 0, center.y - (node.min_y + node.size - 1)}));
+        return dx * dx + dy * dy;
+    };
+
+    // out - max-куча из k лучших; frontier - min-куча узлов по расстоянию.
+    // Память кучи узлов своя у каждого потока и переживает запрос.
+    using Pending = std::pair<int64_t, uint32_t>;
+    static thread_local std::vector<Pending> frontier;
+    std::greater<Pending> farther;
+    frontier.clear();
+    frontier.push_back({box_distance(nodes[0]), 0});
+    while (!frontier.empty()) {
+        std::pop_heap(frontier.begin(), frontier.end(), farther);
+        Pending next = frontier.back();
+        frontier.pop_back();
+        if (next.first > max_distance_sq) break;
+        if (out.size() == k && next.first > out.front().distance_sq) break;
+
+        const Node& node = nodes[next.second];
+        if (!node.is_leaf()) {
+            for (uint32_t q = 0; q < 4; ++q) {
+                const Node& child = nodes[node.first_child + q];
+                if (child.count == 0) continue;
+                frontier.push_back({box_distance(child), node.first_child + q});
+                std::push_heap(frontier.begin(), frontier.end(), farther);
+            }
+            continue;
+        }
+        for (size_t i = 0; i < node.ids.size(); ++i) {
+            int64_t dx = axis_gap(std::abs(static_cast<int64_t>(node.points.xs[i]) - center.x));
+            int64_t dy = axis_gap(std::abs(static_cast<int64_t>(node.points.ys[i]) - center.y));
+            Neighbour candidate{dx * dx + dy * dy, node.ids[i]};
+            if (candidate.distance_sq > max_distance_sq) continue;
+            if (out.size() < k) {
+                out.push_back(candidate);
+                std::push_heap(out.begin(), out.end());
+            } else if (candidate < out.front()) {
+                std::pop_heap(out.begin(), out.end());
+                out.back() = candidate;
+                std::push_heap(out.begin(), out.end());
+            }
+        }
+    }
+    std::sort_heap(out.begin(), out.end());
+}
@@ -0,0 +1,180 @@
+#include "spatial_index.h"
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace {
+
+// Пока плотная сетка не больше ~4 ячеек на точку, ключи раскладываются
+// сортировкой подсчётом; иначе - обычной сортировкой пар (ключ, индекс)
+const int64_t DENSE_CELL_LIMIT = 4096;
+
+int clamp_to_int(int64_t value) {
+    return static_cast<int>(std::max<int64_t>(std::numeric_limits<int>::min(),
+                                              std::min<int64_t>(std::numeric_limits<int>::max(), value)));
+}
+
+uint64_t cell_key(uint32_t row, uint32_t column) {
+    return (static_cast<uint64_t>(row) << 32) | column;
+}
+
+}
+
+SpatialGrid::SpatialGrid(int cell_size) : cell_size(cell_size > 0 ? cell_size : 1) {}
+
+uint32_t SpatialGrid::column_of(int x) const {
+    int64_t column = (static_cast<int64_t>(std::max(min_x, std::min(x, max_x))) - min_x) / cell_size;
+    return static_cast<uint32_t>(column);
+}
+
+uint32_t SpatialGrid::row_of(int y) const {
+    int64_t row = (static_cast<int64_t>(std::max(min_y, std::min(y, max_y))) - min_y) / cell_size;
+    return static_cast<uint32_t>(row);
+}
+
+void SpatialGrid::build(const PositionBlock& positions) {
+    size_t count = positions.size();
+    cell_keys.clear();
+    cell_start.clear();
+    order.clear();
+    sorted.clear();
+    max_x = max_y = -1;
+    min_x = min_y = 0;
+    if (count == 0) return;
+
+    min_x = *std::min_element(positions.xs.begin(), positions.xs.end());
+    max_x = *std::max_element(positions.xs.begin(), positions.xs.end());
+    min_y = *std::min_element(positions.ys.begin(), positions.ys.end());
+    max_y = *std::max_element(positions.ys.begin(), positions.ys.end());
+
+    int64_t cols = (static_cast<int64_t>(max_x) - min_x) / cell_size + 1;
+    int64_t rows = (static_cast<int64_t>(max_y) - min_y) / cell_size + 1;
+    order.resize(count);
+
+    if (cols * rows <= std::max<int64_t>(DENSE_CELL_LIMIT, 4 * static_cast<int64_t>(count))) {
+        // Сортировка подсчётом по плотному номеру ячейки (строки подряд)
+        std::vector<uint32_t> cell_of(count);
+        std::vector<uint32_t> dense_start(static_cast<size_t>(cols * rows) + 1, 0);
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t cell = static_cast<uint32_t>(row_of(positions.ys[i]) * cols + column_of(positions.xs[i]));
+            cell_of[i] = cell;
+            dense_start[cell + 1]++;
+        }
+        for (size_t c = 1; c < dense_start.size(); ++c) {
+            dense_start[c] += dense_start[c - 1];
+        }
+        std::vector<uint32_t> cursor(dense_start.begin(), dense_start.end() - 1);
+        for (size_t i = 0; i < count; ++i) {
+            order[cursor[cell_of[i]]++] = static_cast<uint32_t>(i);
+        }
+        // Остаются только занятые ячейки
+        for (size_t c = 0; c + 1 < dense_start.size(); ++c) {
+            if (dense_start[c] != dense_start[c + 1]) {
+                cell_keys.push_back(cell_key(static_cast<uint32_t>(c / cols), static_cast<uint32_t>(c % cols)));
+                cell_start.push_back(dense_start[c]);
+            }
+        }
+    } else {
+        std::vector<std::pair<uint64_t, uint32_t>> keyed(count);
+        for (size_t i = 0; i < count; ++i) {
+            keyed[i] = {cell_key(row_of(positions.ys[i]), column_of(positions.xs[i])), static_cast<uint32_t>(i)};
+        }
+        std::sort(keyed.begin(), keyed.end());
+        for (size_t k = 0; k < count; ++k) {
+            order[k] = keyed[k].second;
+            if (k == 0 || keyed[k].first != keyed[k - 1].first) {
+                cell_keys.push_back(keyed[k].first);
+                cell_start.push_back(static_cast<uint32_t>(k));
+            }
+        }
+    }
+    cell_start.push_back(static_cast<uint32_t>(count));
+
+    sorted.xs.resize(count);
+    sorted.ys.resize(count);
+    for (size_t k = 0; k < count; ++k) {
+        sorted.xs[k] = positions.xs[order[k]];
+        sorted.ys[k] = positions.ys[order[k]];
+    }
+}
+
+template <class Visit>
+void SpatialGrid::for_each_row_span(int rect_min_x, int rect_min_y, int rect_max_x, int rect_max_y, Visit&& visit) const {
+    if (order.empty() || rect_max_x < min_x || rect_min_x > max_x ||
+        rect_max_y < min_y || rect_min_y > max_y) {
+        return;
+    }
+
+    uint32_t c0 = column_of(rect_min_x);
+    uint32_t c1 = column_of(rect_max_x);
+    uint32_t r0 = row_of(rect_min_y);
+    uint32_t r1 = row_of(rect_max_y);
+    auto first = std::lower_bound(cell_keys.begin(), cell_keys.end(), cell_key(r0, c0));
+    auto last = std::upper_bound(first, cell_keys.end(), cell_key(r1, c1));
+
+    if (static_cast<size_t>(r1 - r0) + 1 <= static_cast<size_t>(last - first)) {
+        // Строк меньше, чем занятых ячеек: на каждую строку - два бинарных поиска
+        for (uint32_t row = r0; row <= r1; ++row) {
+            auto begin = std::lower_bound(first, last, cell_key(row, c0));
+            auto end = std::upper_bound(begin, last, cell_key(row, c1));
+            if (begin != end) {
+                visit(cell_start[begin - cell_keys.begin()], cell_start[end - cell_keys.begin()]);
+            }
+            first = end;
+        }
+        return;
+    }
+
+    // Иначе проще пройти занятые ячейки подряд, склеивая соседние в полосы
+    size_t span_begin = 0;
+    size_t span_end = 0;
+    for (auto it = first; it != last; ++it) {
+        auto column = static_cast<uint32_t>(*it & 0xFFFFFFFFu);
+        if (column < c0 || column > c1) continue;
+        size_t cell = static_cast<size_t>(it - cell_keys.begin());
+        if (cell_start[cell] != span_end) {
+            if (span_begin != span_end) visit(span_begin, span_end);
+            span_begin = cell_start[cell];
+        }
+        span_end = cell_start[cell + 1];
+    }
+    if (span_begin != span_end) visit(span_begin, span_end);
+}
+
+void SpatialGrid::query_radius(const Position& center, int range, std::vector<uint32_t>& out) const {
+    if (range < 0) return;
+
+    for_each_row_span(clamp_to_int(static_cast<int64_t>(center.x) - range),
+                      clamp_to_int(static_cast<int64_t>(center.y) - range),
+                      clamp_to_int(static_cast<int64_t>(center.x) + range),
+                      clamp_to_int(static_cast<int64_t>(center.y) + range),
+                      [&](size_t begin, size_t end) {
+        for (size_t base = begin; base < end; base += RANGE_BLOCK_SIZE) {
+            size_t count = std::min(RANGE_BLOCK_SIZE, end - base);
+            uint64_t mask = range_hit_mask(center, sorted.xs.data() + base, sorted.ys.data() + base, count, range);
+            while (mask) {
+                out.push_back(order[base + static_cast<size_t>(lowest_bit_index(mask))]);
+                mask &= mask - 1;
+            }
+        }
+    });
+}
+
+void SpatialGrid::query_rect(int rect_min_x, int rect_min_y, int rect_max_x, int rect_max_y,
+                             std::vector<uint32_t>& out) const {
+    for_each_row_span(rect_min_x, rect_min_y, rect_max_x, rect_max_y, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            if (sorted.xs[k] >= rect_min_x && sorted.xs[k] <= rect_max_x &&
+                sorted.ys[k] >= rect_min_y && sorted.ys[k] <= rect_max_y) {
+                out.push_back(order[k]);
+            }
+        }
+    });
+}
+
+std::unique_ptr<ISpatialIndex> make_spatial_index(SpatialIndexKind kind, int cell_size) {
+    if (kind == SpatialIndexKind::QUADTREE) {
+        return std::make_unique<QuadTree>();
+    }
+    return std::make_unique<SpatialGrid>(cell_size);
+}
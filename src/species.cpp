@@ -0,0 +1,143 @@
+#include "species.h"
+#include "name_table.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// Строки видов живут в таблице имён: string_view на них не устаревают
+std::string_view stable_view(const std::string& str) {
+    auto& table = NameTable::instance();
+    return table.view(table.intern(str));
+}
+
+// Следующее слово строки; '#' в начале слова открывает комментарий до конца строки
+bool next_token(std::istream& in, std::string& token) {
+    return static_cast<bool>(in >> token) && token[0] != '#';
+}
+
+}
+
+SpeciesRegistry::SpeciesRegistry() {
+    load_defaults();
+}
+
+void SpeciesRegistry::load_defaults() {
+    table.clear();
+    for (const auto& traits : BUILTIN_SPECIES) {
+        Species entry{traits, TypeMask()};
+        uint32_t row = BUILTIN_KILL_MATRIX[static_cast<size_t>(traits.type)];
+        for (size_t victim = 0; victim < NPC_TYPE_COUNT; ++victim) {
+            entry.prey[victim] = (row >> victim) & 1u;
+        }
+        table.push_back(entry);
+    }
+}
+
+bool SpeciesRegistry::find(std::string_view name, NpcType& type) const {
+    for (const auto& entry : table) {
+        if (entry.traits.name == name) {
+            type = entry.traits.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+Species& SpeciesRegistry::add_or_update(const SpeciesTraits& traits) {
+    NpcType type;
+    if (find(traits.name, type)) {
+        Species& entry = table[static_cast<size_t>(type)];
+        entry.traits = traits;
+        entry.traits.type = type;
+        return entry;
+    }
+
+    if (table.size() >= MAX_SPECIES) {
+        throw std::length_error("Too many species, limit is " + std::to_string(MAX_SPECIES));
+    }
+    Species entry{traits, TypeMask()};
+    entry.traits.type = static_cast<NpcType>(table.size());
+    table.push_back(entry);
+    return table.back();
+}
+
+void SpeciesRegistry::load(std::istream& in) {
+    std::string line;
+    int line_number = 0;
+
+    while (std::getline(in, line)) {
+        ++line_number;
+        std::istringstream ls(line);
+        std::string keyword;
+        if (!(ls >> keyword) || keyword[0] == '#') continue;
+
+        auto error = [&](const std::string& what) {
+            return std::runtime_error("Species config line " + std::to_string(line_number) + ": " + what);
+        };
+
+        if (keyword == "species") {
+            std::string name, display_name;
+            char symbol;
+            MovementConfig movement;
+            int dice_sides = DICE_SIDES;
+            if (!(ls >> name >> display_name >> symbol >> movement.move_distance >> movement.kill_distance)) {
+                throw error("expected: species <name> <DisplayName> <symbol> <move> <kill> [dice]");
+            }
+            std::string dice;
+            if (next_token(ls, dice)) {
+                std::istringstream ds(dice);
+                if (!(ds >> dice_sides) || !ds.eof()) {
+                    throw error("dice_sides must be a number, got '" + dice + "'");
+                }
+            }
+            if (movement.move_distance < 0 || movement.kill_distance < 0 || dice_sides < 1) {
+                throw error("distances must be non-negative and dice_sides positive");
+            }
+            add_or_update({NpcType{}, stable_view(name), stable_view(display_name), symbol, movement, dice_sides});
+        } else if (keyword == "kills") {
+            std::string attacker_name, victim_name;
+            NpcType attacker, victim;
+            if (!(ls >> attacker_name) || !find(attacker_name, attacker)) {
+                throw error("unknown attacker '" + attacker_name + "'");
+            }
+            Species& entry = table[static_cast<size_t>(attacker)];
+            while (next_token(ls, victim_name)) {
+                if (!find(victim_name, victim)) {
+                    throw error("unknown victim '" + victim_name + "'");
+                }
+                entry.prey.set(static_cast<size_t>(victim));
+            }
+        } else if (keyword == "nokills") {
+            std::string attacker_name;
+            NpcType attacker;
+            if (!(ls >> attacker_name) || !find(attacker_name, attacker)) {
+                throw error("unknown attacker '" + attacker_name + "'");
+            }
+            table[static_cast<size_t>(attacker)].prey.reset();
+        } else {
+            throw error("unknown keyword '" + keyword + "'");
+        }
+    }
+}
+
+int SpeciesRegistry::max_kill_distance() const {
+    int distance = 0;
+    for (const auto& entry : table) {
+        if (entry.prey.any()) {
+            distance = std::max(distance, entry.traits.movement.kill_distance);
+        }
+    }
+    return distance;
+}
+
+bool SpeciesRegistry::load_from_file(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+    load(file);
+    return true;
+}
@@ -0,0 +1,63 @@
+#include "typed_index.h"
+#include <algorithm>
+
+void TypedIndex::clear() {
+    trees.clear();
+    type_of.clear();
+    item_count = 0;
+}
+
+void TypedIndex::update(uint32_t id, NpcType type, const Position& pos) {
+    uint16_t t = static_cast<uint16_t>(type_index(type));
+    if (id >= type_of.size()) {
+        type_of.resize(static_cast<size_t>(id) + 1, NO_TYPE);
+    }
+    if (type_of[id] != t) {
+        erase(id);
+        if (t >= trees.size()) {
+            trees.resize(static_cast<size_t>(t) + 1);
+        }
+        type_of[id] = t;
+        ++item_count;
+    }
+    trees[t].update(id, pos);
+}
+
+bool TypedIndex::erase(uint32_t id) {
+    if (!contains(id)) return false;
+    trees[type_of[id]].erase(id);
+    type_of[id] = NO_TYPE;
+    --item_count;
+    return true;
+}
+
+void TypedIndex::nearest(const Position& center, const TypeMask& types, size_t k, std::vector<Neighbour>& out,
+                         int64_t max_distance_sq) const {
+    out.clear();
+    if (k == 0) return;
+
+    // Лучшие k каждого дерева сливаются; следующее дерево ищет не дальше k-го найденного
+    std::vector<Neighbour> local;
+    for_each_tree(types, [&](const QuadTree& tree) {
+        int64_t limit = out.size() == k ? std::min(max_distance_sq, out.back().distance_sq) : max_distance_sq;
+        tree.nearest(center, k, local, limit);
+        size_t middle = out.size();
+        out.insert(out.end(), local.begin(), local.end());
+        std::inplace_merge(out.begin(), out.begin() + static_cast<std::ptrdiff_t>(middle), out.end());
+        if (out.size() > k) out.resize(k);
+    });
+}
+
+void TypedIndex::query_radius(const Position& center, int range, const TypeMask& types,
+                              std::vector<uint32_t>& out) const {
+    for_each_tree(types, [&](const QuadTree& tree) {
+        tree.query_radius(center, range, out);
+    });
+}
+
+void TypedIndex::query_rect(int min_x, int min_y, int max_x, int max_y, const TypeMask& types,
+                            std::vector<uint32_t>& out) const {
+    for_each_tree(types, [&](const QuadTree& tree) {
+        tree.query_rect(min_x, min_y, max_x, max_y, out);
+    });
+}
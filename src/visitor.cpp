@@ -1,20 +1,8 @@
 #include "visitor.h"
 #include "npc.h"
-#include <iostream>
+#include "species.h"
 
 bool FightVisitor::visit(const std::shared_ptr<INpc>& npc) {
     if (!npc || !npc->is_alive()) return false;
-
-    // Дракон убивает только быков
-    if (attacker_type == NpcType::DRAGON) {
-        return npc->get_type() == NpcType::BULL;
-    }
-    // Бык убивает лягушек
-    else if (attacker_type == NpcType::BULL) {
-        return npc->get_type() == NpcType::FROG;
-    }
-    // Лягушка никого не убивает
-    else {
-        return false;
-    }
-}
\ No newline at end of file
+    return can_kill(attacker_type, npc->get_type());
+}
@@ -0,0 +1,143 @@
+#include "world_shards.h"
+#include "species.h"
+#include "spatial_index.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+const int64_t MIN_REGION_LIMIT = 64;
+
+}
+
+WorldShards::WorldShards(int region_size)
+    : requested_size(region_size > 0 ? region_size : 1), region_size(requested_size) {}
+
+int WorldShards::column_of(int x) const {
+    return std::max(0, std::min(cols - 1, x / region_size));
+}
+
+int WorldShards::row_of(int y) const {
+    return std::max(0, std::min(rows - 1, y / region_size));
+}
+
+void WorldShards::assign(const CombatView& view, const std::vector<uint32_t>& ids) {
+    size_t count = view.size();
+    int max_x = 0;
+    int max_y = 0;
+    for (size_t i = 0; i < count; ++i) {
+        max_x = std::max(max_x, view.positions.xs[i]);
+        max_y = std::max(max_y, view.positions.ys[i]);
+    }
+    int64_t limit = std::max<int64_t>(MIN_REGION_LIMIT, static_cast<int64_t>(count));
+    int64_t size = requested_size;
+    while ((max_x / size + 1) * (max_y / size + 1) > limit) {
+        size *= 2;
+    }
+    region_size = static_cast<int>(std::min<int64_t>(size, std::numeric_limits<int>::max()));
+    cols = max_x / region_size + 1;
+    rows = max_y / region_size + 1;
+
+    // Сортировка подсчётом по номеру региона, как в SpatialGrid
+    std::vector<uint32_t> region_of(count);
+    region_start.assign(region_count() + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t region = static_cast<uint32_t>(row_of(view.positions.ys[i]) * cols + column_of(view.positions.xs[i]));
+        region_of[i] = region;
+        region_start[region + 1]++;
+    }
+    for (size_t r = 1; r < region_start.size(); ++r) {
+        region_start[r] += region_start[r - 1];
+    }
+
+    std::vector<uint32_t> cursor(region_start.begin(), region_start.end() - 1);
+    owned_order.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        owned_order[cursor[region_of[i]]++] = static_cast<uint32_t>(i);
+    }
+
+    // Номер региона зависит от cols, поэтому переход считается по координатам
+    // региона, а не по его номеру
+    last_migrations = 0;
+    if (ids.size() != count) return;
+
+    const uint64_t UNKNOWN = std::numeric_limits<uint64_t>::max();
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t id = ids[i];
+        if (id >= region_by_id.size()) {
+            region_by_id.resize(static_cast<size_t>(id) + 1, UNKNOWN);
+        }
+        uint64_t cell = (static_cast<uint64_t>(row_of(view.positions.ys[i])) << 32) |
+                        static_cast<uint32_t>(column_of(view.positions.xs[i]));
+        if (region_by_id[id] != UNKNOWN && region_by_id[id] != cell) {
+            ++last_migrations;
+        }
+        region_by_id[id] = cell;
+    }
+}
+
+void WorldShards::find_collisions(const Battle& battle, const CombatView& view,
+                                  std::vector<CombatPair>& out, size_t thread_count,
+                                  SpatialIndexKind kind) const {
+    out.clear();
+    if (region_count() == 0) return;
+
+    int halo = SpeciesRegistry::instance().max_kill_distance();
+    int ring = (halo + region_size - 1) / region_size;
+    thread_count = std::max<size_t>(1, std::min(thread_count, view.size() / MIN_NPCS_PER_THREAD + 1));
+    std::vector<std::vector<CombatPair>> region_pairs(region_count());
+
+    for_each_region(thread_count, [&](size_t region) {
+        int col = static_cast<int>(region % cols);
+        int row = static_cast<int>(region / cols);
+
+        // Крайние регионы забирают всё, что лежит за краем сетки
+        int64_t min_x = col == 0 ? std::numeric_limits<int>::min() : int64_t(col) * region_size - halo;
+        int64_t min_y = row == 0 ? std::numeric_limits<int>::min() : int64_t(row) * region_size - halo;
+        int64_t max_x = col == cols - 1 ? std::numeric_limits<int>::max() : int64_t(col + 1) * region_size - 1 + halo;
+        int64_t max_y = row == rows - 1 ? std::numeric_limits<int>::max() : int64_t(row + 1) * region_size - 1 + halo;
+
+        // Свои NPC идут первыми и только они атакуют; за ними призраки соседей
+        CombatView local;
+        std::vector<uint32_t> local_ids;
+        size_t own = owned_count(region);
+        const uint32_t* members = owned(region);
+        for (size_t k = 0; k < own; ++k) {
+            local.append(view, members[k]);
+            local_ids.push_back(members[k]);
+        }
+        for (int r = std::max(0, row - ring); r <= std::min(rows - 1, row + ring); ++r) {
+            for (int c = std::max(0, col - ring); c <= std::min(cols - 1, col + ring); ++c) {
+                size_t neighbour = static_cast<size_t>(r) * cols + c;
+                if (neighbour == region) continue;
+                const uint32_t* ghosts = owned(neighbour);
+                for (size_t k = 0; k < owned_count(neighbour); ++k) {
+                    uint32_t i = ghosts[k];
+                    int x = view.positions.xs[i];
+                    int y = view.positions.ys[i];
+                    if (!view.alive[i] || x < min_x || x > max_x || y < min_y || y > max_y) continue;
+                    local.append(view, i);
+                    local_ids.push_back(i);
+                }
+            }
+        }
+
+        auto index = make_spatial_index(kind, std::max(halo, 1));
+        index->build(local.positions);
+        std::vector<CombatPair> pairs;
+        battle.find_collisions(local, *index, own, pairs, SerialPolicy());
+
+        auto& result = region_pairs[region];
+        result.reserve(pairs.size());
+        for (const auto& pair : pairs) {
+            result.push_back({local_ids[pair.attacker], local_ids[pair.defender]});
+        }
+    });
+
+    for (auto& pairs : region_pairs) {
+        out.insert(out.end(), pairs.begin(), pairs.end());
+    }
+    std::sort(out.begin(), out.end(), [](const CombatPair& a, const CombatPair& b) {
+        return a.attacker != b.attacker ? a.attacker < b.attacker : a.defender < b.defender;
+    });
+}
@@ -1,7 +1,13 @@
 #include "gtest/gtest.h"
 #include "battle.h"
 #include "npc_types.h"
+#include "species.h"
+#include <algorithm>
+#include <random>
+#include <sstream>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 
 class MockObserver : public IObserver {
@@ -46,6 +52,86 @@ TEST(BattleTest, FightVisitorLogic) {
     EXPECT_FALSE(frog_visitor->visit(frog));
 }
 
+TEST(BattleTest, KillMatrixMatchesVisitor) {
+    std::vector<std::shared_ptr<INpc>> npcs = {
+        std::make_shared<Dragon>("Dragon", 0, 0),
+        std::make_shared<Frog>("Frog", 0, 0),
+        std::make_shared<Bull>("Bull", 0, 0),
+    };
+
+    for (int a = 0; a < NPC_TYPE_COUNT; ++a) {
+        auto attacker = static_cast<NpcType>(a);
+        auto visitor = std::make_shared<FightVisitor>(attacker);
+        for (const auto& npc : npcs) {
+            EXPECT_EQ(can_kill(attacker, npc->get_type()), npc->accept(visitor));
+        }
+    }
+
+    npcs[2]->kill();
+    EXPECT_FALSE(npcs[2]->accept(std::make_shared<FightVisitor>(NpcType::DRAGON)));
+}
+
+TEST(BattleTest, SpeciesConfig) {
+    SpeciesRegistry registry;
+    EXPECT_EQ(registry.size(), static_cast<size_t>(NPC_TYPE_COUNT));
+
+    std::istringstream config(
+        "# comment\n"
+        "species wolf Wolf W 5 4\n"
+        "species sheep Sheep S 2 1 4\n"
+        "species bull Bull B 7 3   # без кубика\n"
+        "species goat Goat # 3 1 8 # символ вида '#' - не комментарий\n"
+        "kills wolf sheep frog # и никого больше\n"
+        "nokills dragon\n");
+    registry.load(config);
+
+    ASSERT_EQ(registry.size(), static_cast<size_t>(NPC_TYPE_COUNT + 3));
+    NpcType wolf, sheep, goat;
+    ASSERT_TRUE(registry.find("wolf", wolf));
+    ASSERT_TRUE(registry.find("sheep", sheep));
+    ASSERT_TRUE(registry.find("goat", goat));
+    EXPECT_EQ(registry.get(goat).traits.symbol, '#');
+    EXPECT_EQ(registry.get(goat).traits.dice_sides, 8);
+    EXPECT_EQ(registry.get(NpcType::BULL).traits.dice_sides, DICE_SIDES);
+    EXPECT_EQ(type_index(wolf), static_cast<size_t>(NPC_TYPE_COUNT));
+    EXPECT_EQ(registry.get(sheep).traits.dice_sides, 4);
+    EXPECT_EQ(registry.get(wolf).traits.symbol, 'W');
+
+    EXPECT_TRUE(registry.can_kill(wolf, sheep));
+    EXPECT_TRUE(registry.can_kill(wolf, NpcType::FROG));
+    EXPECT_FALSE(registry.can_kill(sheep, wolf));
+    EXPECT_FALSE(registry.can_kill(NpcType::DRAGON, NpcType::BULL));
+    EXPECT_TRUE(registry.can_kill(NpcType::BULL, NpcType::FROG));
+    EXPECT_EQ(registry.get(NpcType::BULL).traits.movement.move_distance, 7);
+
+    std::istringstream bad("kills wolf unicorn\n");
+    EXPECT_THROW(registry.load(bad), std::runtime_error);
+    std::istringstream bad_dice("species yak Yak Y 1 1 six\n");
+    EXPECT_THROW(registry.load(bad_dice), std::runtime_error);
+}
+
+TEST(BattleTest, ManySpeciesKillMatrix) {
+    SpeciesRegistry registry;
+    std::ostringstream config;
+    for (int i = 0; i < 100; ++i) {
+        config << "species s" << i << " S" << i << " s 1 1\n";
+    }
+    for (int i = 1; i < 100; ++i) {
+        config << "kills s" << i << " s" << i - 1 << "\n";
+    }
+    std::istringstream in(config.str());
+    registry.load(in);
+
+    ASSERT_EQ(registry.size(), static_cast<size_t>(NPC_TYPE_COUNT + 100));
+    NpcType first, last, before_last;
+    ASSERT_TRUE(registry.find("s0", first));
+    ASSERT_TRUE(registry.find("s99", last));
+    ASSERT_TRUE(registry.find("s98", before_last));
+    EXPECT_TRUE(registry.can_kill(last, before_last));
+    EXPECT_FALSE(registry.can_kill(before_last, last));
+    EXPECT_FALSE(registry.can_kill(first, last));
+}
+
 TEST(BattleTest, BattleDistance) {
     std::vector<std::shared_ptr<INpc>> npcs;
     auto dragon = std::make_shared<Dragon>("Dragon", 0, 0);
@@ -66,3 +152,127 @@ TEST(BattleTest, BattleDistance) {
     EXPECT_EQ(npcs.size(), 2);         
 }
 
+
+namespace {
+
+std::vector<std::shared_ptr<BaseNpc>> random_npcs(size_t count, int side, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> coord(0, side - 1);
+    std::uniform_int_distribution<int> type(0, static_cast<int>(NPC_TYPE_COUNT) - 1);
+    std::vector<std::shared_ptr<BaseNpc>> npcs;
+    for (size_t i = 0; i < count; ++i) {
+        npcs.push_back(std::make_shared<BaseNpc>(static_cast<NpcType>(type(gen)), "Npc", coord(gen), coord(gen)));
+    }
+    return npcs;
+}
+
+std::vector<uint64_t> pair_keys(const std::vector<CombatPair>& pairs) {
+    std::vector<uint64_t> keys;
+    for (const auto& pair : pairs) {
+        keys.push_back((static_cast<uint64_t>(pair.attacker) << 32) | pair.defender);
+    }
+    return keys;
+}
+
+}
+
+TEST(BattleTest, ExecutionPoliciesAgree) {
+    auto npcs = random_npcs(3000, 200, 7);
+    CombatView view;
+    view.assign(npcs.begin(), npcs.end());
+    SpatialGrid grid(5);
+    grid.build(view.positions);
+
+    Battle battle;
+    std::vector<CombatPair> serial, deterministic, parallel;
+    battle.find_fights(view, grid, 5, serial, SerialPolicy());
+    battle.find_fights(view, grid, 5, deterministic, DeterministicPolicy(4, 64));
+    battle.find_fights(view, grid, 5, parallel, ParallelPolicy(4, 64));
+
+    ASSERT_FALSE(serial.empty());
+    EXPECT_EQ(pair_keys(serial), pair_keys(deterministic));
+
+    auto serial_keys = pair_keys(serial);
+    auto parallel_keys = pair_keys(parallel);
+    std::sort(parallel_keys.begin(), parallel_keys.end());
+    EXPECT_EQ(serial_keys, parallel_keys);
+
+    CombatView serial_view = view;
+    CombatView parallel_view = view;
+    auto claim = [](uint32_t, uint32_t) { return true; };
+    auto report = [](uint32_t, uint32_t) {};
+    size_t serial_deaths = battle.apply_kills(serial, serial_view, claim, report, SerialPolicy());
+    size_t parallel_deaths = battle.apply_kills(parallel, parallel_view, claim, report, ParallelPolicy(4, 64));
+    EXPECT_EQ(serial_deaths, parallel_deaths);
+    EXPECT_EQ(serial_view.alive, parallel_view.alive);
+}
+
+TEST(BattleTest, EachDeathReportedOnce) {
+    // Плотная толпа: у каждой жертвы много атакующих, и часть атакующих сами жертвы
+    auto npcs = random_npcs(4000, 40, 11);
+    CombatView view;
+    view.assign(npcs.begin(), npcs.end());
+    SpatialGrid grid(3);
+    grid.build(view.positions);
+
+    Battle battle;
+    std::vector<CombatPair> pairs;
+    battle.find_fights(view, grid, 3, pairs, ParallelPolicy(4, 64));
+
+    std::vector<uint32_t> victims;
+    for (const auto& pair : pairs) {
+        victims.push_back(pair.defender);
+    }
+    std::sort(victims.begin(), victims.end());
+    victims.erase(std::unique(victims.begin(), victims.end()), victims.end());
+    ASSERT_GT(pairs.size(), victims.size());
+
+    // Два пакета разбираются одновременно и спорят за одних и тех же жертв
+    std::vector<int> reports(npcs.size(), 0);
+    std::mutex reports_mutex;
+    size_t deaths[2] = {0, 0};
+    auto resolve = [&](int slot) {
+        CombatView local_view = view;
+        deaths[slot] = battle.apply_kills(pairs, local_view,
+            [&](uint32_t, uint32_t victim) { return npcs[victim]->try_kill(); },
+            [&](uint32_t, uint32_t victim) {
+                std::lock_guard<std::mutex> lock(reports_mutex);
+                ++reports[victim];
+            },
+            ParallelPolicy(4, 64));
+    };
+    std::thread other(resolve, 1);
+    resolve(0);
+    other.join();
+
+    EXPECT_EQ(deaths[0] + deaths[1], victims.size());
+    for (uint32_t victim : victims) {
+        EXPECT_EQ(reports[victim], 1);
+        EXPECT_FALSE(npcs[victim]->is_alive());
+    }
+}
+
+TEST(BattleTest, DuelsSkipDeadAndHarmless) {
+    Dragon dragon("Dragon", 0, 0);
+    Bull bull("Bull", 1, 1);
+    Frog frog("Frog", 2, 2);
+    frog.kill();
+
+    std::vector<Duel> duels(3);
+    duels[0].attacker = &bull;
+    duels[0].defender = &dragon;    // бык не охотится на драконов
+    duels[1].attacker = &bull;
+    duels[1].defender = &frog;       // лягушка уже мертва
+    duels[2].attacker = &dragon;
+    duels[2].defender = &bull;
+
+    Battle battle;
+    battle.resolve_duels(duels);
+
+    EXPECT_FALSE(duels[0].fought);
+    EXPECT_FALSE(duels[1].fought);
+    EXPECT_TRUE(duels[2].fought);
+    EXPECT_EQ(duels[2].killed, duels[2].attack > duels[2].defense);
+    EXPECT_EQ(bull.is_alive(), !duels[2].killed);
+    EXPECT_FALSE(duels[2].lost_claim);
+}
@@ -2,6 +2,8 @@
 #include "factory.h"
 #include <sstream>
 #include <fstream>
+#include <unordered_set>
+#include <thread>
 
 TEST(FactoryTest, CreateNPC) {
     NpcFactory factory;
@@ -45,6 +47,20 @@ TEST(FactoryTest, ClearNames) {
     EXPECT_EQ(npc2->get_name(), "Test");  // Снова может быть "Test"
 }
 
+TEST(FactoryTest, UniqueNamesWithNumericSuffix) {
+    NpcFactory factory;
+
+    auto npc1 = factory.create_npc(NpcType::FROG, "Frog", 10, 20);
+    auto npc2 = factory.create_npc(NpcType::FROG, "Frog1", 10, 20);
+    auto npc3 = factory.create_npc(NpcType::FROG, "Frog", 10, 20);
+    auto npc4 = factory.create_npc(NpcType::FROG, "Frog1", 10, 20);
+
+    EXPECT_EQ(npc1->get_name(), "Frog");
+    EXPECT_EQ(npc2->get_name(), "Frog1");
+    EXPECT_EQ(npc3->get_name(), "Frog2");
+    EXPECT_EQ(npc4->get_name(), "Frog11");
+}
+
 TEST(FactoryTest, CreateFromStream) {
     NpcFactory factory;
     
@@ -110,4 +126,132 @@ TEST(FactoryTest, SaveToFile) {
     
     file.close();
     std::remove(test_filename.c_str());
-}
\ No newline at end of file
+}
+
+TEST(FactoryTest, PoolReusesSlots) {
+    NpcFactory factory;
+    std::vector<std::shared_ptr<INpc>> npcs;
+
+    for (int i = 0; i < 100; ++i) {
+        npcs.push_back(factory.create_npc(NpcType::FROG, "Frog", i, i));
+    }
+    auto first = factory.get_pool_stats(NpcType::FROG);
+    EXPECT_EQ(first.slot_allocations, 100u);
+    EXPECT_EQ(first.slot_reuses, 0u);
+    EXPECT_EQ(first.live_slots, 100u);
+    EXPECT_LT(first.block_allocations, 100u);
+
+    npcs.clear();
+    EXPECT_EQ(factory.get_pool_stats(NpcType::FROG).live_slots, 0u);
+
+    for (int i = 0; i < 100; ++i) {
+        npcs.push_back(factory.create_npc(NpcType::FROG, "Frog", i, i));
+    }
+    auto second = factory.get_pool_stats(NpcType::FROG);
+    EXPECT_EQ(second.slot_reuses, 100u);
+    EXPECT_EQ(second.block_allocations, first.block_allocations);
+    EXPECT_EQ(second.fallback_allocations, 0u);
+
+    factory.release_pools();
+    EXPECT_EQ(factory.get_pool_stats().reserved_slots, second.reserved_slots);
+
+    npcs.clear();
+    factory.release_pools();
+    EXPECT_EQ(factory.get_pool_stats().reserved_slots, 0u);
+}
+
+TEST(FactoryTest, PooledNpcOutlivesFactory) {
+    std::shared_ptr<INpc> npc;
+    {
+        NpcFactory factory;
+        npc = factory.create_npc(NpcType::DRAGON, "Dragon", 1, 2);
+    }
+    ASSERT_NE(npc, nullptr);
+    EXPECT_EQ(npc->get_name(), "Dragon");
+    EXPECT_EQ(npc->get_position().x, 1);
+}
+
+TEST(FactoryTest, GenerateWorldIsDeterministic) {
+    GameConfig bounds{-20, 79, 0, 49};
+    NpcFactory serial;
+    NpcFactory parallel;
+    auto one = serial.generate_world(3 * WORLD_BLOCK_SIZE + 17, bounds, 99, 1);
+    auto many = parallel.generate_world(3 * WORLD_BLOCK_SIZE + 17, bounds, 99, 4);
+    ASSERT_EQ(one.size(), many.size());
+
+    std::unordered_set<std::string> names;
+    for (size_t i = 0; i < one.size(); ++i) {
+        ASSERT_NE(one[i], nullptr);
+        EXPECT_EQ(one[i]->get_type(), many[i]->get_type());
+        EXPECT_EQ(one[i]->get_position().x, many[i]->get_position().x);
+        EXPECT_EQ(one[i]->get_position().y, many[i]->get_position().y);
+        EXPECT_EQ(one[i]->get_name_id(), many[i]->get_name_id());
+        EXPECT_TRUE(bounds.contains(one[i]->get_position().x, one[i]->get_position().y));
+        names.insert(one[i]->get_name());
+    }
+    EXPECT_EQ(names.size(), one.size());
+    EXPECT_EQ(serial.get_pool_stats().live_slots, one.size());
+
+    // Зарезервированные номера не выдаются снова, в том числе по явному имени
+    EXPECT_EQ(names.count(serial.create_npc(NpcType::FROG, "Frog", 0, 0)->get_name()), 0u);
+    EXPECT_EQ(names.count(serial.create_npc(NpcType::FROG, "Frog1", 0, 0)->get_name()), 0u);
+
+    auto other = serial.generate_world(100, bounds, 100, 1);
+    size_t same = 0;
+    for (size_t i = 0; i < other.size(); ++i) {
+        same += other[i]->get_position().x == one[i]->get_position().x;
+    }
+    EXPECT_LT(same, 50u);
+}
+
+TEST(FactoryTest, ConcurrentCreateGivesUniqueNames) {
+    NpcFactory factory(GameConfig{0, 499, 0, 499});
+    const size_t threads = 8;
+    const size_t per_thread = 5000;
+    std::vector<std::vector<std::shared_ptr<BaseNpc>>> made(threads);
+
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            for (size_t i = 0; i < per_thread; ++i) {
+                // Основа без номера и явные имена, которые пересекаются между потоками
+                std::string name = i % 4 == 0 ? "Frog" + std::to_string(i + 1) : "Frog";
+                made[t].push_back(factory.create_npc(NpcType::FROG, name, 1, 1));
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    std::unordered_set<std::string> names;
+    for (const auto& list : made) {
+        for (const auto& npc : list) {
+            EXPECT_TRUE(names.insert(npc->get_name()).second) << npc->get_name();
+        }
+    }
+    EXPECT_EQ(names.size(), threads * per_thread);
+    EXPECT_EQ(factory.get_pool_stats(NpcType::FROG).live_slots, threads * per_thread);
+}
+
+TEST(FactoryTest, ReleasedNamesAreReused) {
+    NpcFactory factory(GameConfig{0, 499, 0, 499});
+    // Постоянное население: 100 живых, каждый раунд все заменяются новыми.
+    // Одновременно занято не больше 200 имён, и номера берутся из освобождённых,
+    // поэтому не растут от раунда к раунду.
+    std::vector<NameId> alive;
+    for (int round = 0; round < 20; ++round) {
+        std::unordered_set<uint64_t> names;
+        std::vector<NameId> next;
+        for (int i = 0; i < 100; ++i) {
+            NameId name = factory.create_npc(NpcType::FROG, "Frog", 1, 1)->get_name_id();
+            EXPECT_LE(name.ordinal, 200 + 2 * NameGenerator::ORDINAL_BLOCK);
+            EXPECT_TRUE(names.insert(name.key()).second);
+            next.push_back(name);
+        }
+        for (const auto& name : alive) {
+            factory.release_name(name);
+        }
+        alive = next;
+    }
+}
@@ -1,7 +1,12 @@
 #include "gtest/gtest.h"
 #include "game.h"
+#include <algorithm>
 #include <thread>
 #include <chrono>
+#include <fstream>
+#include <random>
+#include <cstdio>
+#include <unordered_set>
 
 using namespace std::chrono_literals;
 
@@ -30,6 +35,29 @@ TEST_F(GameTest, InitializeGame) {
     EXPECT_LE(game.get_alive_count(), 10);
 }
 
+TEST_F(GameTest, InitializeGameWithSeed) {
+    GameConfig world{0, 999, 0, 999};
+    Game first(world);
+    Game second(world);
+    first.initialize_game(20000, 7);
+    second.initialize_game(20000, 7);
+    ASSERT_EQ(first.get_alive_count(), 20000);
+
+    auto first_handles = first.get_handles();
+    auto second_handles = second.get_handles();
+    ASSERT_EQ(first_handles.size(), second_handles.size());
+    for (size_t i = 0; i < first_handles.size(); i += 997) {
+        auto a = first.get_npc(first_handles[i]);
+        auto b = second.get_npc(second_handles[i]);
+        EXPECT_EQ(a->get_name(), b->get_name());
+        EXPECT_EQ(a->get_position().x, b->get_position().x);
+        EXPECT_EQ(a->get_position().y, b->get_position().y);
+    }
+    // Повторная инициализация заменяет мир целиком
+    first.initialize_game(10, 7);
+    EXPECT_EQ(first.get_alive_count(), 10);
+}
+
 TEST_F(GameTest, GameTime) {
     Game game;
     int time_before = game.get_game_time();
@@ -94,4 +122,337 @@ TEST_F(GameTest, PrintFunctions) {
     EXPECT_NO_THROW(game.print_npcs());
     EXPECT_NO_THROW(game.print_map());
     EXPECT_NO_THROW(game.print_survivors());
-}
\ No newline at end of file
+}
+
+TEST_F(GameTest, HandlesBecomeStaleAfterDeath) {
+    Game game;
+    auto dragon = game.add_npc(NpcType::DRAGON, "Dragon", 10, 10);
+    auto bull = game.add_npc(NpcType::BULL, "Bull", 12, 12);
+    auto frog = game.add_npc(NpcType::FROG, "Frog", 400, 400);
+
+    ASSERT_TRUE(game.contains(dragon));
+    ASSERT_TRUE(game.contains(bull));
+    EXPECT_EQ(game.get_npc(bull)->get_name(), "Bull");
+
+    // Убитый, но ещё не убранный NPC уже не считается живым
+    game.get_npc(bull)->kill();
+    EXPECT_FALSE(game.contains(bull));
+    bull = game.add_npc(NpcType::BULL, "Bull", 12, 12);
+
+    game.fight(5);
+
+    EXPECT_TRUE(game.contains(dragon));
+    EXPECT_FALSE(game.contains(bull));
+    EXPECT_EQ(game.get_npc(bull), nullptr);
+    EXPECT_TRUE(game.contains(frog));
+    EXPECT_EQ(game.get_handles().size(), 2u);
+}
+
+TEST_F(GameTest, GraveyardWaitsForOlderPins) {
+    NpcGraveyard graveyard;
+    std::vector<std::shared_ptr<BaseNpc>> removed{std::make_shared<Frog>("Frog", 1, 1)};
+    std::weak_ptr<BaseNpc> frog = removed[0];
+
+    NpcPin before = graveyard.pin();
+    graveyard.bury(removed);
+    EXPECT_TRUE(removed.empty());
+    NpcPin after = graveyard.pin();   // взята после уборки и лягушку не держит
+    EXPECT_FALSE(frog.expired());
+
+    before.reset();
+    EXPECT_TRUE(frog.expired());
+    EXPECT_EQ(graveyard.buried_count(), 0u);
+    EXPECT_TRUE(after.pinned());
+}
+
+TEST_F(GameTest, ParallelFightMatchesSerial) {
+    const std::string test_filename = "test_parallel_fight.txt";
+    {
+        std::mt19937 gen(2024);
+        std::uniform_int_distribution<int> coord(0, 120);
+        std::uniform_int_distribution<int> type(0, NPC_TYPE_COUNT - 1);
+        const char* names[] = {"dragon", "frog", "bull"};
+        std::ofstream file(test_filename);
+        file << 2000 << "\n";
+        for (int i = 0; i < 2000; ++i) {
+            file << names[type(gen)] << " " << coord(gen) << " " << coord(gen) << " \"Npc" << i << "\"\n";
+        }
+    }
+
+    auto survivors = [&](size_t threads) {
+        Game game;
+        game.load_from_file(test_filename);
+        game.fight(3, threads);
+        std::vector<std::string> names;
+        for (auto handle : game.get_handles()) {
+            names.push_back(game.get_npc(handle)->get_name());
+        }
+        return names;
+    };
+
+    auto serial = survivors(1);
+    auto parallel = survivors(4);
+    EXPECT_LT(serial.size(), 2000u);
+    EXPECT_EQ(serial, parallel);
+    EXPECT_EQ(serial, survivors(0));
+
+    std::remove(test_filename.c_str());
+}
+
+TEST_F(GameTest, AddNpcsInBulk) {
+    Game game;
+    std::vector<NpcSpec> specs;
+    for (int i = 0; i < 1000; ++i) {
+        specs.push_back({static_cast<NpcType>(i % NPC_TYPE_COUNT), "Bulk", i % 100, i / 10});
+    }
+    specs[10].x = -1;
+    specs[20].y = EDITOR_MAX_Y + 1;
+    specs[30].type = static_cast<NpcType>(SpeciesRegistry::instance().size());
+
+    AddNpcsSummary summary = game.add_npcs(specs);
+    EXPECT_EQ(summary.requested, 1000u);
+    EXPECT_EQ(summary.added, 997u);
+    EXPECT_EQ(summary.out_of_bounds, 2u);
+    EXPECT_EQ(summary.unknown_type, 1u);
+    ASSERT_EQ(summary.handles.size(), specs.size());
+    EXPECT_FALSE(summary.handles[10].valid());
+    EXPECT_FALSE(summary.handles[30].valid());
+    EXPECT_EQ(game.get_alive_count(), 997);
+
+    auto npc = game.get_npc(summary.handles[42]);
+    ASSERT_NE(npc, nullptr);
+    EXPECT_EQ(npc->get_type(), specs[42].type);
+    EXPECT_EQ(npc->get_position().x, specs[42].x);
+    EXPECT_EQ(npc->get_position().y, specs[42].y);
+    EXPECT_EQ(game.count_in_rect({0, 99, 0, 99}, TypeMask().set()), 997u);
+}
+
+// После initialize_game фабрика проверяет границы мира, а не редактора
+TEST_F(GameTest, AddNpcsUsesFactoryBounds) {
+    Game game;
+    game.initialize_game(5);
+    AddNpcsSummary summary = game.add_npcs({{NpcType::FROG, "A", 10, 10}, {NpcType::FROG, "B", 300, 300}});
+    EXPECT_EQ(summary.added, 1u);
+    EXPECT_EQ(summary.out_of_bounds, 1u);
+    EXPECT_TRUE(summary.handles[0].valid());
+    EXPECT_FALSE(summary.handles[1].valid());
+    EXPECT_EQ(game.get_alive_count(), 6);
+}
+
+TEST_F(GameTest, ConcurrentAddsWhileRunning) {
+    Game game;
+    game.initialize_game(200);
+    game.start();
+
+    std::vector<std::vector<NpcHandle>> added(4);
+    std::vector<std::thread> writers;
+    for (size_t w = 0; w < added.size(); ++w) {
+        writers.emplace_back([&, w]() {
+            for (int i = 0; i < 200; ++i) {
+                added[w].push_back(game.add_npc(NpcType::FROG, "Editor", i % MAP_WIDTH, (i * 7) % MAP_HEIGHT));
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    game.stop();
+
+    std::vector<uint64_t> values;
+    for (const auto& handles : added) {
+        for (auto handle : handles) {
+            ASSERT_TRUE(handle.valid());
+            values.push_back(handle.value);
+        }
+    }
+    std::sort(values.begin(), values.end());
+    EXPECT_EQ(std::unique(values.begin(), values.end()), values.end());
+}
+
+TEST_F(GameTest, RuntimeWorldBounds) {
+    GameConfig world = {0, 99999, 0, 99999};
+    Game game(world);
+    game.initialize_game(1000);
+    EXPECT_EQ(game.get_world_bounds().width(), 100000);
+
+    game.start();
+    std::this_thread::sleep_for(150ms);
+    game.stop();
+
+    for (auto handle : game.get_handles()) {
+        Position pos = game.get_npc(handle)->get_position();
+        EXPECT_TRUE(world.contains(pos.x, pos.y));
+    }
+    EXPECT_NO_THROW(game.print_map());
+
+    EXPECT_THROW(game.set_world_bounds({10, 5, 0, 10}), std::invalid_argument);
+    game.set_world_bounds({0, 9, 0, 9});
+    game.initialize_game(50);
+    for (auto handle : game.get_handles()) {
+        Position pos = game.get_npc(handle)->get_position();
+        EXPECT_TRUE(game.get_world_bounds().contains(pos.x, pos.y));
+    }
+}
+
+TEST_F(GameTest, QuadTreeIndexWhileRunning) {
+    Game game;
+    game.set_spatial_index(SpatialIndexKind::QUADTREE);
+    game.initialize_game(500);
+    game.start();
+    EXPECT_THROW(game.set_spatial_index(SpatialIndexKind::GRID), std::logic_error);
+    std::this_thread::sleep_for(200ms);
+    game.stop();
+
+    EXPECT_GT(game.get_tick_count(), 0u);
+    EXPECT_GT(game.get_alive_count(), 0);
+    EXPECT_NO_THROW(game.fight(20));
+    EXPECT_EQ(game.get_spatial_index(), SpatialIndexKind::QUADTREE);
+}
+
+TEST_F(GameTest, NearestAndRadiusQueries) {
+    Game game;
+    NpcHandle near_frog = game.add_npc(NpcType::FROG, "Frog", 12, 10);
+    NpcHandle far_frog = game.add_npc(NpcType::FROG, "Frog", 40, 10);
+    NpcHandle bull = game.add_npc(NpcType::BULL, "Bull", 11, 10);
+
+    auto found = game.nearest({10, 10}, type_mask(NpcType::FROG), 5);
+    ASSERT_EQ(found.size(), 2u);
+    EXPECT_EQ(found[0], near_frog);
+    EXPECT_EQ(found[1], far_frog);
+
+    auto around = game.query_radius({10, 10}, 5, TypeMask().set());
+    EXPECT_EQ(around.size(), 2u);
+    EXPECT_NE(std::find(around.begin(), around.end(), bull), around.end());
+
+    // Мёртвые и убранные NPC из ответов пропадают
+    game.fight(5);
+    found = game.nearest({10, 10}, type_mask(NpcType::FROG), 5);
+    ASSERT_EQ(found.size(), 1u);
+    EXPECT_EQ(found[0], far_frog);
+}
+
+TEST_F(GameTest, CountInRectByType) {
+    Game game;
+    game.add_npc(NpcType::FROG, "Frog", 12, 10);
+    game.add_npc(NpcType::FROG, "Frog", 40, 10);
+    game.add_npc(NpcType::BULL, "Bull", 11, 10);
+    game.add_npc(NpcType::DRAGON, "Dragon", 90, 90);
+    ASSERT_EQ(game.get_density_cell_size(), 1);
+
+    GameConfig left{0, 20, 0, 20};
+    EXPECT_EQ(game.count_in_rect(left, NpcType::FROG), 1u);
+    EXPECT_EQ(game.count_in_rect(left, TypeMask().set()), 2u);
+    TypeMask frogs_and_dragons = type_mask(NpcType::FROG) | type_mask(NpcType::DRAGON);
+    EXPECT_EQ(game.count_in_rect(game.get_world_bounds(), frogs_and_dragons), 3u);
+
+    // Убитые пропадают из ответа
+    game.fight(5);
+    EXPECT_EQ(game.count_in_rect(left, TypeMask().set()), 1u);
+
+    // После игры сетка совпадает с хранилищем
+    game.initialize_game(300);
+    game.start();
+    for (int wait = 0; wait < 100 && game.get_tick_count() < 3; ++wait) {
+        std::this_thread::sleep_for(20ms);
+    }
+    EXPECT_LE(game.count_in_rect(game.get_world_bounds(), TypeMask().set()), 300u);
+    game.stop();
+    EXPECT_EQ(game.count_in_rect(game.get_world_bounds(), TypeMask().set()),
+              static_cast<uint64_t>(game.get_alive_count()));
+}
+
+TEST_F(GameTest, PredatorsSeekPrey) {
+    Game game(GameConfig{0, 499, 0, 499});
+    NpcHandle bull = game.add_npc(NpcType::BULL, "Bull", 0, 0);
+    NpcHandle frog = game.add_npc(NpcType::FROG, "Frog", 450, 450);
+    double start_distance = game.get_npc(bull)->get_position().distance_to(game.get_npc(frog)->get_position());
+
+    game.set_movement_mode(MovementMode::SEEK_PREY);
+    game.start();
+    for (int wait = 0; wait < 100 && game.get_tick_count() < 4; ++wait) {
+        std::this_thread::sleep_for(20ms);
+    }
+    game.stop();
+
+    ASSERT_GE(game.get_tick_count(), 4u);
+    ASSERT_TRUE(game.contains(frog));
+    double distance = game.get_npc(bull)->get_position().distance_to(game.get_npc(frog)->get_position());
+    // Каждый тик бык проходит до 30 по обеим осям, лягушка - до 1
+    EXPECT_LT(distance, start_distance - 100.0);
+}
+
+TEST_F(GameTest, StorageReorderKeepsHandles) {
+    Game game(GameConfig{0, 999, 0, 999});
+    game.initialize_game(3000);
+    auto handles = game.get_handles();
+    std::vector<Position> positions;
+    for (auto handle : handles) {
+        positions.push_back(game.get_npc(handle)->get_position());
+    }
+    EXPECT_GT(game.get_storage_disorder(), 0.3);
+
+    EXPECT_TRUE(game.reorder_storage());
+    EXPECT_EQ(game.get_storage_disorder(), 0.0);
+    EXPECT_EQ(game.get_reorder_count(), 1u);
+    for (size_t i = 0; i < handles.size(); ++i) {
+        ASSERT_TRUE(game.contains(handles[i]));
+        Position pos = game.get_npc(handles[i])->get_position();
+        EXPECT_EQ(pos.x, positions[i].x);
+        EXPECT_EQ(pos.y, positions[i].y);
+    }
+
+    // Пересортировка по счётчику тиков идёт в потоке движения
+    game.set_storage_reorder(1, 2.0);
+    game.start();
+    for (int wait = 0; wait < 100 && game.get_reorder_count() < 3; ++wait) {
+        std::this_thread::sleep_for(20ms);
+    }
+    EXPECT_THROW(game.set_storage_reorder(0, 0.5), std::logic_error);
+    game.stop();
+    EXPECT_GE(game.get_reorder_count(), 3u);
+}
+
+TEST_F(GameTest, RespawnKeepsPopulation) {
+    Game game(GameConfig{0, 19, 0, 19});
+    game.set_population_target({10, 10, 10});
+    game.start();
+    std::this_thread::sleep_for(1300ms);
+    game.stop();
+
+    EXPECT_GE(game.get_respawn_count(), 30u);
+    EXPECT_GT(game.get_alive_count(), 0);
+    EXPECT_LE(game.get_alive_count(), 30);
+    std::unordered_set<std::string> names;
+    for (auto handle : game.get_handles()) {
+        auto npc = game.get_npc(handle);
+        if (npc->is_alive()) {
+            EXPECT_TRUE(names.insert(npc->get_name()).second) << npc->get_name();
+        }
+    }
+    auto history = game.get_tick_rate_history();
+    ASSERT_FALSE(history.empty());
+    EXPECT_GT(history.front().ticks_per_second, 0.0);
+    EXPECT_THROW(game.set_population_target(std::vector<size_t>(300, 1)), std::invalid_argument);
+}
+
+TEST_F(GameTest, BattleLogRotates) {
+    std::remove("rotation_log.txt");
+    std::remove("rotation_log.txt.1");
+    std::remove("rotation_log.txt.2");
+    FileObserver observer("rotation_log.txt");
+    observer.set_rotation(200, 1);
+    KillEvent event{NpcHandle(), NpcHandle(), NameTable::instance().make_name("Dragon1"),
+                    NameTable::instance().make_name("Frog2")};
+    for (int i = 0; i < 50; ++i) {
+        observer.on_kill_event(event);
+    }
+    std::ifstream current("rotation_log.txt", std::ios::ate);
+    std::ifstream rotated("rotation_log.txt.1", std::ios::ate);
+    ASSERT_TRUE(current.is_open());
+    ASSERT_TRUE(rotated.is_open());
+    EXPECT_LE(static_cast<int>(current.tellg()), 200);
+    EXPECT_LE(static_cast<int>(rotated.tellg()), 200);
+    EXPECT_FALSE(std::ifstream("rotation_log.txt.2").is_open());
+    std::remove("rotation_log.txt");
+    std::remove("rotation_log.txt.1");
+}
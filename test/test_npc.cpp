@@ -2,7 +2,9 @@
 #include "npc_types.h"
 #include "visitor.h"
 #include "constants.h"
+#include "distance_kernel.h"
 #include <memory>
+#include <limits>
 
 TEST(NPCTest, PositionDistance) {
     Position p1{0, 0};
@@ -12,14 +14,15 @@ TEST(NPCTest, PositionDistance) {
 
 TEST(NPCTest, PositionBounds) {
     Position p1{50, 50};
-    EXPECT_TRUE(p1.is_within_game_bounds());
+    EXPECT_TRUE(p1.is_within(WORLD_BOUNDS));
     
     Position p2{-1, 50};
-    EXPECT_FALSE(p2.is_within_game_bounds());
+    EXPECT_FALSE(p2.is_within(WORLD_BOUNDS));
     
     Position p3{499, 50};  
-    EXPECT_TRUE(p3.is_within_editor_bounds());
-    EXPECT_FALSE(p3.is_within_game_bounds());
+    EXPECT_TRUE(p3.is_within(EDITOR_BOUNDS));
+    EXPECT_FALSE(p3.is_within(WORLD_BOUNDS));
+    EXPECT_TRUE(p3.is_within(GameConfig{0, 999, 0, 999}));
 }
 
 TEST(NPCTest, DragonCreation) {
@@ -38,7 +41,7 @@ TEST(NPCTest, DragonMovement) {
     EXPECT_EQ(config.kill_distance, DRAGON_CONFIG.kill_distance);
     
     for (int i = 0; i < 100; ++i) {
-        dragon->move();
+        dragon->move(WORLD_BOUNDS);
         auto pos = dragon->get_position();
         EXPECT_GE(pos.x, 0);
         EXPECT_LE(pos.x, MAP_WIDTH - 1);
@@ -55,7 +58,7 @@ TEST(NPCTest, KillMethod) {
     EXPECT_FALSE(npc->is_alive());
     
     Position old_pos = npc->get_position();
-    npc->move();
+    npc->move(WORLD_BOUNDS);
     EXPECT_EQ(npc->get_position().x, old_pos.x);
     EXPECT_EQ(npc->get_position().y, old_pos.y);
 }
@@ -110,4 +113,109 @@ TEST(NPCTest, InfoString) {
     dragon->kill();
     info = dragon->info();
     EXPECT_TRUE(info.find("[DEAD]") != std::string::npos);
-}
\ No newline at end of file
+}
+
+TEST(NPCTest, NameInterning) {
+    auto& table = NameTable::instance();
+    EXPECT_EQ(table.intern("Frog"), table.intern("Frog"));
+    EXPECT_EQ(table.view(table.intern("Frog")), "Frog");
+
+    NameId generated = table.make_name("Frog123");
+    EXPECT_EQ(generated.base, table.intern("Frog"));
+    EXPECT_EQ(generated.ordinal, 123u);
+    EXPECT_EQ(table.format(generated), "Frog123");
+
+    // Суффиксы с ведущим нулём и чисто числовые имена не разбиваются
+    EXPECT_EQ(table.make_name("Frog0").ordinal, 0u);
+    EXPECT_EQ(table.make_name("Frog007").ordinal, 0u);
+    EXPECT_EQ(table.format(table.make_name("Frog007")), "Frog007");
+    EXPECT_EQ(table.make_name("42").ordinal, 0u);
+
+    auto frog = std::make_shared<Frog>("Frog77", 0, 0);
+    EXPECT_EQ(frog->get_name(), "Frog77");
+    EXPECT_EQ(frog->get_name_id(), table.make_name("Frog77"));
+    EXPECT_EQ(frog->get_type_str(), "frog");
+}
+
+TEST(NPCTest, SpeciesTable) {
+    EXPECT_EQ(species(NpcType::DRAGON).movement.kill_distance, DRAGON_CONFIG.kill_distance);
+    EXPECT_EQ(species(NpcType::FROG).movement.move_distance, FROG_CONFIG.move_distance);
+
+    auto bull = std::make_shared<Bull>("Bull", 0, 0);
+    EXPECT_EQ(bull->get_movement_config().move_distance, BULL_CONFIG.move_distance);
+    EXPECT_EQ(bull->get_type_str(), species(NpcType::BULL).name);
+
+    NpcType type = NpcType::DRAGON;
+    EXPECT_TRUE(species_from_name("frog", type));
+    EXPECT_EQ(type, NpcType::FROG);
+    EXPECT_FALSE(species_from_name("unicorn", type));
+
+    // Адаптер INpc даёт те же результаты, что и прямой вызов
+    std::shared_ptr<INpc> npc = bull;
+    EXPECT_EQ(npc->get_movement_config().kill_distance, BULL_CONFIG.kill_distance);
+    // Мир меньше WORLD_BOUNDS, как при размере из командной строки
+    GameConfig small_world{0, 9, 0, 9};
+    for (int i = 0; i < 50; ++i) {
+        npc->move(small_world);
+        EXPECT_TRUE(npc->get_position().is_within(small_world));
+    }
+}
+
+TEST(NPCTest, RangeKernelMatchesDistance) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> coord(-600, 600);
+
+    for (int round = 0; round < 50; ++round) {
+        Position center{coord(gen), coord(gen)};
+        PositionBlock block;
+        std::vector<Position> points;
+        for (size_t i = 0; i < RANGE_BLOCK_SIZE; ++i) {
+            Position p{coord(gen), coord(gen)};
+            points.push_back(p);
+            block.push_back(p);
+        }
+
+        for (int range : {0, 1, 30, 250, 1000}) {
+            for (size_t count : {size_t(0), size_t(3), size_t(17), RANGE_BLOCK_SIZE}) {
+                uint64_t expected = 0;
+                for (size_t i = 0; i < count; ++i) {
+                    if (center.distance_to(points[i]) <= range) expected |= uint64_t(1) << i;
+                }
+                EXPECT_EQ(range_hit_mask(center, block.xs.data(), block.ys.data(), count, range), expected);
+                EXPECT_EQ(range_hit_mask_scalar(center, block.xs.data(), block.ys.data(), count, range), expected);
+            }
+        }
+    }
+
+    // Ровно на границе: 3-4-5
+    PositionBlock edge;
+    edge.push_back({3, 4});
+    EXPECT_EQ(range_hit_mask({0, 0}, edge.xs.data(), edge.ys.data(), 1, 5), 1u);
+    EXPECT_EQ(range_hit_mask({0, 0}, edge.xs.data(), edge.ys.data(), 1, 4), 0u);
+    EXPECT_EQ(range_hit_mask({0, 0}, edge.xs.data(), edge.ys.data(), 1, -1), 0u);
+
+    // Разности больше 2^31 не сворачиваются в близкие точки
+    const int32_t low = std::numeric_limits<int32_t>::min();
+    const int32_t high = std::numeric_limits<int32_t>::max();
+    PositionBlock far;
+    for (int i = 0; i < 4; ++i) {
+        far.push_back({high, high});
+    }
+    far.push_back({low + 5, low});
+    for (int range : {10, 1 << 30, high}) {
+        EXPECT_EQ(range_hit_mask({low, low}, far.xs.data(), far.ys.data(), far.size(), range), 1u << 4);
+        EXPECT_EQ(range_hit_mask_scalar({low, low}, far.xs.data(), far.ys.data(), far.size(), range), 1u << 4);
+    }
+}
+
+TEST(NPCTest, ForEachInRangeVisitsAllBlocks) {
+    PositionBlock block;
+    for (int i = 0; i < 200; ++i) {
+        block.push_back({i, 0});
+    }
+    std::vector<size_t> hits;
+    for_each_in_range({100, 0}, block, 70, [&](size_t index) { hits.push_back(index); });
+    ASSERT_EQ(hits.size(), 141u);
+    EXPECT_EQ(hits.front(), 30u);
+    EXPECT_EQ(hits.back(), 170u);
+}
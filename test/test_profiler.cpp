@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+#include "phase_profiler.h"
+#include "game.h"
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST(ProfilerTest, BucketsCoverValuesWithinAnEighth) {
+    for (uint64_t ns : {0ull, 7ull, 8ull, 100ull, 12345ull, 1000000007ull, ~0ull}) {
+        size_t bucket = PhaseHistogram::bucket_of(ns);
+        ASSERT_LT(bucket, PhaseHistogram::BUCKETS);
+        uint64_t limit = PhaseHistogram::bucket_limit(bucket);
+        EXPECT_GE(limit, ns);
+        EXPECT_LE(limit - ns, ns / 8);
+        if (bucket > 0) {
+            EXPECT_LT(PhaseHistogram::bucket_limit(bucket - 1), ns);
+        }
+    }
+}
+
+TEST(ProfilerTest, PercentilesMergeAcrossThreads) {
+    PhaseProfiler& profiler = PhaseProfiler::instance();
+    profiler.reset();
+
+    // Два потока пишут половины 1..1000 мкс в свои гистограммы
+    std::vector<std::thread> writers;
+    for (uint64_t half = 0; half < 2; ++half) {
+        writers.emplace_back([&profiler, half]() {
+            for (uint64_t us = 1 + half * 500; us <= 500 + half * 500; ++us) {
+                profiler.record(TickPhase::CLEANUP, us * 1000);
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+
+    PhaseStats stats = profiler.stats()[static_cast<size_t>(TickPhase::CLEANUP)];
+    EXPECT_EQ(stats.count, 1000u);
+    EXPECT_EQ(stats.max_ns, 1000000u);
+    EXPECT_GE(stats.p50_ns, 500000u);
+    EXPECT_LE(stats.p50_ns, 500000u + 500000u / 8);
+    EXPECT_GE(stats.p99_ns, 990000u);
+    EXPECT_LE(stats.p99_ns, 990000u + 990000u / 8);
+
+    profiler.reset();
+    EXPECT_EQ(profiler.stats()[static_cast<size_t>(TickPhase::CLEANUP)].count, 0u);
+}
+
+// В сборке без профилировщика фазы игры не пишутся вовсе
+TEST(ProfilerTest, GamePhasesFollowBuildFlag) {
+    PhaseProfiler::instance().reset();
+    Game game(GameConfig{0, 49, 0, 49});
+    game.initialize_game(200, 3);
+    game.start();
+    std::this_thread::sleep_for(300ms);
+    game.stop();
+
+    auto stats = PhaseProfiler::instance().stats();
+    uint64_t ticks = stats[static_cast<size_t>(TickPhase::TICK)].count;
+    uint64_t cleanups = stats[static_cast<size_t>(TickPhase::CLEANUP)].count;
+    if (PHASE_PROFILER_ENABLED) {
+        EXPECT_GT(ticks, 0u);
+        EXPECT_GT(cleanups, 0u);
+        EXPECT_EQ(stats[static_cast<size_t>(TickPhase::MOVEMENT)].count, ticks);
+    } else {
+        EXPECT_EQ(ticks, 0u);
+        EXPECT_EQ(cleanups, 0u);
+    }
+    // Бой редактора убирает мёртвых вне тика и в CLEANUP не попадает
+    game.fight(5);
+    EXPECT_EQ(PhaseProfiler::instance().stats()[static_cast<size_t>(TickPhase::CLEANUP)].count, cleanups);
+    std::ostringstream out;
+    PhaseProfiler::instance().print(out);
+    EXPECT_NE(out.str().find("collisions"), std::string::npos);
+    EXPECT_NE(out.str().find("queue_drain"), std::string::npos);
+}
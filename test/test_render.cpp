@@ -0,0 +1,259 @@
+#include "gtest/gtest.h"
+#include "map_renderer.h"
+#include "game.h"
+#include "density_grid.h"
+#include "species.h"
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST(RenderTest, DiffSendsOnlyChangedCells) {
+    FrameBuffer before(20, 3);
+    before.fill('.');
+    FrameBuffer after = before;
+    after.at(2, 0) = 'D';
+    after.at(15, 2) = 'F';
+
+    size_t changed = 0;
+    std::string out = MapRenderer::diff(before, after, &changed);
+    EXPECT_EQ(changed, 2u);
+    EXPECT_EQ(out, "\x1b[1;3HD\x1b[3;16HF");
+    EXPECT_TRUE(MapRenderer::diff(after, after).empty());
+
+    // Близкие изменения в строке склеиваются в один участок
+    after.at(5, 0) = 'B';
+    out = MapRenderer::diff(before, after, &changed);
+    EXPECT_EQ(out.find("\x1b[1;3HD..B"), 0u);
+}
+
+TEST(RenderTest, RendererRedrawsOnResizeAndPeriodically) {
+    MapRenderer renderer(3);
+    FrameBuffer frame(4, 2);
+    frame.fill('.');
+
+    std::string first = renderer.next(frame);
+    EXPECT_EQ(first.rfind("\x1b[H\x1b[2J", 0), 0u);
+    EXPECT_EQ(renderer.last_changed_cells(), 8u);
+
+    frame.at(1, 1) = 'B';
+    EXPECT_EQ(renderer.next(frame), "\x1b[2;2HB");
+    EXPECT_EQ(renderer.last_changed_cells(), 1u);
+    EXPECT_TRUE(renderer.next(frame).empty());
+    // Четвёртый кадр - плановая полная перерисовка (раз в три кадра)
+    EXPECT_EQ(renderer.next(frame).rfind("\x1b[H\x1b[2J", 0), 0u);
+
+    frame.resize(5, 2);
+    EXPECT_EQ(renderer.next(frame).rfind("\x1b[H\x1b[2J", 0), 0u);
+}
+
+TEST(RenderTest, PrintMapWritesOneBuffer) {
+    Game game;
+    game.add_npc(NpcType::DRAGON, "Dragon", 3, 4);
+
+    std::vector<std::string> writes;
+    game.set_frame_writer([&](const std::string& text) { writes.push_back(text); });
+    game.print_map();
+
+    ASSERT_EQ(writes.size(), 1u);
+    EXPECT_NE(writes[0].find("MAP"), std::string::npos);
+    EXPECT_NE(writes[0].find("...D"), std::string::npos);
+    EXPECT_NE(writes[0].find("Alive:   1"), std::string::npos);
+}
+
+TEST(RenderTest, LiveMapSendsDiffs) {
+    Game game;
+    game.initialize_game(200);
+
+    std::mutex mutex;
+    std::vector<std::string> writes;
+    game.set_frame_writer([&](const std::string& text) {
+        std::lock_guard<std::mutex> lock(mutex);
+        writes.push_back(text);
+    });
+    game.start_live_map(50);
+    EXPECT_THROW(game.set_frame_writer(nullptr), std::logic_error);
+    game.start();
+    std::this_thread::sleep_for(300ms);
+    game.stop();
+    game.stop_live_map();
+
+    EXPECT_GE(game.get_frames_rendered(), 5u);
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_GE(writes.size(), 2u);
+    EXPECT_EQ(writes[0].rfind("\x1b[H\x1b[2J", 0), 0u);
+    // Между тиками кадр меняется мало: diff заметно короче полного кадра
+    size_t smallest = writes[1].size();
+    for (size_t i = 1; i < writes.size(); ++i) {
+        smallest = std::min(smallest, writes[i].size());
+    }
+    EXPECT_LT(smallest, writes[0].size() / 2);
+}
+
+TEST(RenderTest, DensityGridMatchesBruteForce) {
+    GameConfig world{-50, 149, 0, 199};
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> xs(-60, 160);
+    std::uniform_int_distribution<int> ys(-10, 210);
+    std::vector<Position> points;
+    std::vector<NpcType> types;
+    for (int i = 0; i < 3000; ++i) {
+        points.push_back({xs(gen), ys(gen)});
+        types.push_back(static_cast<NpcType>(i % NPC_TYPE_COUNT));
+    }
+
+    // Клетка 1x1 - точный ответ; клетка 25x25 - по клеткам, которых касается прямоугольник
+    for (int max_side : {512, 8}) {
+        DensityGrid grid;
+        grid.reset(world, NPC_TYPE_COUNT, max_side);
+        for (size_t i = 0; i < points.size(); ++i) {
+            grid.update(static_cast<uint32_t>(i), types[i], points[i]);
+        }
+        grid.build_sums();
+        EXPECT_EQ(grid.get_total(), points.size());
+        int cell = grid.get_cell_size();
+        EXPECT_EQ(cell, max_side == 512 ? 1 : 25);
+
+        TypeMask frogs_and_bulls;
+        frogs_and_bulls.set(static_cast<size_t>(NpcType::FROG));
+        frogs_and_bulls.set(static_cast<size_t>(NpcType::BULL));
+        for (int q = 0; q < 200; ++q) {
+            int x0 = xs(gen), x1 = xs(gen), y0 = ys(gen), y1 = ys(gen);
+            if (x0 > x1) std::swap(x0, x1);
+            if (y0 > y1) std::swap(y0, y1);
+            int c0, r0, c1, r1;
+            bool inside = grid.cell_range(x0, y0, x1, y1, c0, r0, c1, r1);
+            uint32_t bulls = 0;
+            uint64_t mixed = 0;
+            for (size_t i = 0; i < points.size(); ++i) {
+                const Position& p = points[i];
+                if (!inside || !world.contains(p.x, p.y)) continue;
+                int column = (p.x - world.min_x) / cell;
+                int row = (p.y - world.min_y) / cell;
+                if (column < c0 || column > c1 || row < r0 || row > r1) continue;
+                if (types[i] == NpcType::BULL) ++bulls;
+                if (types[i] != NpcType::DRAGON) ++mixed;
+            }
+            EXPECT_EQ(grid.count(NpcType::BULL, x0, y0, x1, y1), bulls);
+            EXPECT_EQ(grid.count(frogs_and_bulls, x0, y0, x1, y1), mixed);
+        }
+    }
+}
+
+TEST(RenderTest, DensityGridUpdatesInPlace) {
+    GameConfig world{0, 99, 0, 99};
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<int> coord(-5, 104);
+    std::uniform_int_distribution<int> step(-3, 3);
+    std::vector<Position> points(500);
+    for (auto& p : points) {
+        p = {coord(gen), coord(gen)};
+    }
+
+    DensityGrid grid;
+    grid.reset(world, NPC_TYPE_COUNT);
+    for (int tick = 0; tick < 20; ++tick) {
+        // Часть NPC ходит, часть меняет вид в том же слоте, часть исчезает
+        for (size_t i = 0; i < points.size(); ++i) {
+            points[i].x += step(gen);
+            points[i].y += step(gen);
+            NpcType type = static_cast<NpcType>((i + (i % 7 == 0 ? tick : 0)) % NPC_TYPE_COUNT);
+            if ((i + tick) % 11 == 0) {
+                grid.erase(static_cast<uint32_t>(i));
+            } else {
+                grid.update(static_cast<uint32_t>(i), type, points[i]);
+            }
+        }
+        grid.build_sums();
+
+        DensityGrid fresh;
+        fresh.reset(world, NPC_TYPE_COUNT);
+        for (uint32_t i = 0; i < points.size(); ++i) {
+            if (grid.contains(i)) {
+                fresh.update(i, static_cast<NpcType>((i + (i % 7 == 0 ? tick : 0)) % NPC_TYPE_COUNT), points[i]);
+            }
+        }
+        fresh.build_sums();
+        EXPECT_EQ(grid.get_total(), fresh.get_total());
+        for (int q = 0; q < 50; ++q) {
+            int x0 = coord(gen), x1 = coord(gen), y0 = coord(gen), y1 = coord(gen);
+            for (size_t t = 0; t < NPC_TYPE_COUNT; ++t) {
+                NpcType type = static_cast<NpcType>(t);
+                ASSERT_EQ(grid.count(type, x0, y0, x1, y1), fresh.count(type, x0, y0, x1, y1));
+            }
+        }
+    }
+}
+
+TEST(RenderTest, ViewportZoomsIntoRect) {
+    Game game({0, 499, 0, 499});
+    game.add_npc(NpcType::DRAGON, "Dragon", 250, 250);
+    game.add_npc(NpcType::FROG, "Frog", 253, 251);
+
+    std::vector<std::string> writes;
+    game.set_frame_writer([&](const std::string& text) { writes.push_back(text); });
+    game.print_map();
+    ASSERT_EQ(writes.size(), 1u);
+    // Весь мир: символ на 5x5 клеток, оба NPC в одном символе
+    EXPECT_NE(writes[0].find("1 symbol = 5x5 cells"), std::string::npos);
+    EXPECT_NE(writes[0].find("Alive:   2"), std::string::npos);
+
+    game.set_map_viewport({240, 259, 245, 254});
+    game.print_map();
+    ASSERT_EQ(writes.size(), 2u);
+    EXPECT_NE(writes[1].find("x 240..259, y 245..254"), std::string::npos);
+    EXPECT_NE(writes[1].find("..........D.........\n.............F......"), std::string::npos);
+    EXPECT_EQ(writes[1].find("GRID"), std::string::npos);
+
+    // В большом мире окно мельче клетки сетки плотности: NPC берутся из
+    // индекса, и каждый символ - своя клетка мира
+    game.set_world_bounds({0, 99999, 0, 99999});
+    ASSERT_GT(game.get_density_cell_size(), 1);
+    game.set_map_viewport({240, 259, 245, 254});
+    game.print_map();
+    ASSERT_EQ(writes.size(), 3u);
+    EXPECT_NE(writes[2].find("..........D.........\n.............F......"), std::string::npos);
+
+    // Длинная строка окна переносится внутри рамки шириной 52
+    game.set_map_viewport({50000, 50039, 72000, 72039});
+    game.print_map();
+    ASSERT_EQ(writes.size(), 4u);
+    EXPECT_NE(writes[3].find("| VIEW: x 50000..50039, y 72000..72039,"), std::string::npos);
+    EXPECT_NE(writes[3].find("|   1 symbol = 1x1 cells"), std::string::npos);
+    std::istringstream lines(writes[3]);
+    std::string line;
+    while (std::getline(lines, line) && line.find("+---") == std::string::npos) {
+        if (!line.empty()) {
+            EXPECT_EQ(line.size(), 52u) << line;
+        }
+    }
+
+    EXPECT_THROW(game.set_map_viewport({10, 5, 0, 0}), std::invalid_argument);
+    game.reset_map_viewport();
+    EXPECT_EQ(game.get_map_viewport(), game.get_world_bounds());
+}
+
+TEST(RenderTest, DensityLayerCountsNpcs) {
+    Game game;
+    for (int i = 0; i < 5; ++i) {
+        game.add_npc(NpcType::BULL, "Bull", 40, 30);
+    }
+    game.add_npc(NpcType::FROG, "Frog", 41, 30);
+
+    std::vector<std::string> writes;
+    game.set_frame_writer([&](const std::string& text) { writes.push_back(text); });
+    game.set_map_layer(MapLayer::DENSITY);
+    game.print_map();
+    game.set_map_layer(MapLayer::TYPES);
+    game.print_map();
+
+    ASSERT_EQ(writes.size(), 2u);
+    // 5 NPC - от 2^2, одна лягушка - 2^0
+    EXPECT_NE(writes[0].find("....31...."), std::string::npos);
+    EXPECT_NE(writes[1].find("....BF...."), std::string::npos);
+}
@@ -0,0 +1,101 @@
+#include "gtest/gtest.h"
+#include "slot_map.h"
+#include <string>
+
+TEST(SlotMapTest, InsertGet) {
+    SlotMap<std::string> map;
+    auto a = map.insert("a");
+    auto b = map.insert("b");
+
+    ASSERT_NE(map.get(a), nullptr);
+    EXPECT_EQ(*map.get(a), "a");
+    EXPECT_EQ(*map.get(b), "b");
+    EXPECT_EQ(map.size(), 2u);
+    EXPECT_FALSE(map.contains(NpcHandle()));
+}
+
+TEST(SlotMapTest, StaleHandleAfterErase) {
+    SlotMap<int> map;
+    auto a = map.insert(1);
+    auto b = map.insert(2);
+
+    EXPECT_TRUE(map.erase(a));
+    EXPECT_FALSE(map.contains(a));
+    EXPECT_EQ(map.get(a), nullptr);
+    EXPECT_FALSE(map.erase(a));
+    EXPECT_EQ(*map.get(b), 2);
+
+    auto c = map.insert(3);
+    EXPECT_NE(c, a);
+    EXPECT_FALSE(map.contains(a));
+    EXPECT_EQ(*map.get(c), 3);
+}
+
+TEST(SlotMapTest, EraseIfKeepsOrderAndHandles) {
+    SlotMap<int> map;
+    std::vector<NpcHandle> handles;
+    for (int i = 0; i < 10; ++i) {
+        handles.push_back(map.insert(i));
+    }
+
+    EXPECT_EQ(map.erase_if([](int value) { return value % 2 == 0; }), 5u);
+    ASSERT_EQ(map.size(), 5u);
+    for (size_t i = 0; i < map.size(); ++i) {
+        EXPECT_EQ(map[i], static_cast<int>(2 * i + 1));
+        EXPECT_EQ(map.handle_at(i), handles[2 * i + 1]);
+    }
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(map.contains(handles[i]), i % 2 == 1);
+    }
+}
+
+TEST(SlotMapTest, ClearInvalidatesHandles) {
+    SlotMap<int> map;
+    auto a = map.insert(1);
+    map.clear();
+    EXPECT_TRUE(map.empty());
+    EXPECT_FALSE(map.contains(a));
+    auto b = map.insert(2);
+    EXPECT_FALSE(map.contains(a));
+    EXPECT_TRUE(map.contains(b));
+}
+
+TEST(SlotMapTest, ReorderKeepsHandles) {
+    SlotMap<int> map;
+    std::vector<NpcHandle> handles;
+    for (int i = 0; i < 6; ++i) {
+        handles.push_back(map.insert(i * 10));
+    }
+
+    map.reorder({5, 3, 1, 0, 2, 4});
+    EXPECT_EQ(map[0], 50);
+    EXPECT_EQ(map[1], 30);
+    EXPECT_EQ(map.handle_at(0), handles[5]);
+    for (int i = 0; i < 6; ++i) {
+        ASSERT_NE(map.get(handles[i]), nullptr);
+        EXPECT_EQ(*map.get(handles[i]), i * 10);
+    }
+
+    // Удаление после перестановки находит элемент по новому месту
+    EXPECT_TRUE(map.erase(handles[3]));
+    EXPECT_EQ(*map.get(handles[4]), 40);
+    EXPECT_THROW(map.reorder({0, 1}), std::invalid_argument);
+}
+
+TEST(SlotMapTest, HandleKeepsFullGeneration) {
+    SlotHandle handle(SlotHandle::INDEX_MASK - 1, SlotHandle::GENERATION_MASK);
+    EXPECT_TRUE(handle.valid());
+    EXPECT_EQ(handle.index(), SlotHandle::INDEX_MASK - 1);
+    EXPECT_EQ(handle.generation(), SlotHandle::GENERATION_MASK);
+
+    // Поколение в 32 бита не сворачивается за тысячу повторных занятий слота
+    SlotMap<int> map;
+    auto first = map.insert(0);
+    for (int i = 1; i <= 2048; ++i) {
+        map.clear();
+        auto next = map.insert(i);
+        ASSERT_EQ(next.index(), first.index());
+        ASSERT_FALSE(map.contains(first));
+    }
+    EXPECT_EQ(map.retired_slots(), 0u);
+}
@@ -0,0 +1,428 @@
+#include "gtest/gtest.h"
+#include "spatial_index.h"
+#include "world_shards.h"
+#include "typed_index.h"
+#include "morton.h"
+#include "npc_types.h"
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <random>
+
+namespace {
+
+PositionBlock random_block(size_t count, int min_coord, int max_coord, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> coord(min_coord, max_coord);
+    PositionBlock block;
+    for (size_t i = 0; i < count; ++i) {
+        block.push_back({coord(gen), coord(gen)});
+    }
+    return block;
+}
+
+std::vector<uint32_t> brute_radius(const PositionBlock& block, const Position& center, int range) {
+    std::vector<uint32_t> result;
+    for (size_t i = 0; i < block.size(); ++i) {
+        if (center.distance_to({block.xs[i], block.ys[i]}) <= range) {
+            result.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    return result;
+}
+
+}
+
+TEST(SpatialTest, GridRadiusMatchesBruteForce) {
+    auto block = random_block(3000, -50, 550, 7);
+    for (int cell : {1, 10, 64, 1000}) {
+        SpatialGrid grid(cell);
+        grid.build(block);
+
+        std::mt19937 gen(cell);
+        std::uniform_int_distribution<int> coord(-100, 600);
+        for (int q = 0; q < 100; ++q) {
+            Position center{coord(gen), coord(gen)};
+            int range = q % 7 * 15;
+            std::vector<uint32_t> hits;
+            grid.query_radius(center, range, hits);
+            std::sort(hits.begin(), hits.end());
+            EXPECT_EQ(hits, brute_radius(block, center, range));
+        }
+    }
+}
+
+TEST(SpatialTest, GridRect) {
+    auto block = random_block(1000, 0, 99, 3);
+    SpatialGrid grid(8);
+    grid.build(block);
+
+    std::vector<uint32_t> hits;
+    grid.query_rect(10, 20, 30, 25, hits);
+    std::sort(hits.begin(), hits.end());
+
+    std::vector<uint32_t> expected;
+    for (size_t i = 0; i < block.size(); ++i) {
+        if (block.xs[i] >= 10 && block.xs[i] <= 30 && block.ys[i] >= 20 && block.ys[i] <= 25) {
+            expected.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    EXPECT_EQ(hits, expected);
+
+    hits.clear();
+    grid.query_rect(200, 200, 300, 300, hits);
+    EXPECT_TRUE(hits.empty());
+}
+
+TEST(SpatialTest, GridStaysSmallForSparsePoints) {
+    PositionBlock block;
+    block.push_back({0, 0});
+    block.push_back({1000000, 1000000});
+    SpatialGrid grid(1);
+    grid.build(block);
+    EXPECT_LE(grid.cell_count(), 4096u);
+
+    std::vector<uint32_t> hits;
+    grid.query_radius({1000000, 999999}, 1, hits);
+    ASSERT_EQ(hits.size(), 1u);
+    EXPECT_EQ(hits[0], 1u);
+}
+
+TEST(SpatialTest, ShardedCollisionsMatchGlobal) {
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<int> coord(0, 299);
+    std::uniform_int_distribution<int> type(0, static_cast<int>(NPC_TYPE_COUNT) - 1);
+    std::vector<std::shared_ptr<BaseNpc>> npcs;
+    for (int i = 0; i < 3000; ++i) {
+        npcs.push_back(std::make_shared<BaseNpc>(static_cast<NpcType>(type(gen)), "Npc", coord(gen), coord(gen)));
+    }
+    CombatView view;
+    view.assign(npcs.begin(), npcs.end());
+
+    Battle battle;
+    SpatialGrid grid(SpeciesRegistry::instance().max_kill_distance());
+    grid.build(view.positions);
+    std::vector<CombatPair> global;
+    battle.find_collisions(view, grid, global);
+
+    // Регион меньше дистанции атаки дракона: призраки берутся через несколько колец
+    for (int region_size : {16, 64, 500}) {
+        WorldShards shards(region_size);
+        shards.assign(view);
+        std::vector<CombatPair> sharded;
+        shards.find_collisions(battle, view, sharded, 4);
+
+        ASSERT_EQ(sharded.size(), global.size()) << "region_size " << region_size;
+        for (size_t i = 0; i < global.size(); ++i) {
+            EXPECT_EQ(sharded[i].attacker, global[i].attacker);
+            EXPECT_EQ(sharded[i].defender, global[i].defender);
+        }
+    }
+}
+
+TEST(SpatialTest, ShardsCountMigrations) {
+    std::vector<std::shared_ptr<BaseNpc>> npcs = {
+        std::make_shared<BaseNpc>(NpcType::FROG, "A", 10, 10),
+        std::make_shared<BaseNpc>(NpcType::FROG, "B", 70, 10),
+        std::make_shared<BaseNpc>(NpcType::FROG, "C", 70, 70),
+    };
+    std::vector<uint32_t> ids = {0, 1, 2};
+    CombatView view;
+    view.assign(npcs.begin(), npcs.end());
+
+    WorldShards shards(64);
+    shards.assign(view, ids);
+    EXPECT_EQ(shards.region_count(), 4u);
+    EXPECT_EQ(shards.migrations(), 0u);
+
+    // A переходит в соседний регион, C остаётся в своём
+    view.positions.xs[0] = 65;
+    view.positions.ys[2] = 100;
+    shards.assign(view, ids);
+    EXPECT_EQ(shards.migrations(), 1u);
+    EXPECT_EQ(shards.owned_count(1), 2u);
+}
+
+// Больше 65536 столбцов: регион (строка 1, столбец 0) и (0, 65536) различаются
+TEST(SpatialTest, ShardsCountMigrationsInWideWorlds) {
+    const int wide = 65536;
+    const size_t count = 2 * (wide + 1);
+    CombatView view;
+    for (size_t i = 0; i < count; ++i) {
+        view.positions.push_back({wide, 1});
+        view.types.push_back(NpcType::FROG);
+        view.alive.push_back(1);
+    }
+    view.positions.xs[0] = 0;
+    std::vector<uint32_t> ids(count);
+    for (size_t i = 0; i < count; ++i) {
+        ids[i] = static_cast<uint32_t>(i);
+    }
+
+    WorldShards shards(1);
+    shards.assign(view, ids);
+    ASSERT_EQ(shards.region_count(), count);
+    view.positions.xs[0] = wide;
+    view.positions.ys[0] = 0;
+    shards.assign(view, ids);
+    EXPECT_EQ(shards.migrations(), 1u);
+}
+
+TEST(SpatialTest, ShardsReuseWorkerThreads) {
+    std::vector<std::shared_ptr<BaseNpc>> npcs;
+    for (int i = 0; i < 64; ++i) {
+        npcs.push_back(std::make_shared<BaseNpc>(NpcType::FROG, "F", (i % 8) * 64, (i / 8) * 64));
+    }
+    CombatView view;
+    view.assign(npcs.begin(), npcs.end());
+    WorldShards shards(64);
+    shards.assign(view);
+
+    std::vector<std::atomic<int>> visits(shards.region_count());
+    for (int tick = 0; tick < 20; ++tick) {
+        shards.for_each_region(4, [&](size_t region) { visits[region]++; });
+        EXPECT_EQ(shards.worker_threads(), 3u);
+    }
+    for (const auto& region : visits) {
+        EXPECT_EQ(region.load(), 20);
+    }
+}
+
+TEST(SpatialTest, SparseGridMemoryFollowsPoints) {
+    // 100k x 100k мир с тремя плотными скоплениями
+    std::mt19937 gen(9);
+    std::uniform_int_distribution<int> offset(-200, 200);
+    const Position centers[] = {{1000, 1000}, {50000, 72000}, {99000, 5}};
+    PositionBlock block;
+    for (int i = 0; i < 3000; ++i) {
+        const Position& c = centers[i % 3];
+        block.push_back({std::max(0, c.x + offset(gen)), std::max(0, c.y + offset(gen))});
+    }
+
+    SpatialGrid grid(4);
+    grid.build(block);
+    EXPECT_EQ(grid.get_cell_size(), 4);
+    EXPECT_LE(grid.cell_count(), block.size());
+
+    for (int i = 0; i < 100; ++i) {
+        Position center = {block.xs[i * 7], block.ys[i * 7]};
+        for (int range : {0, 5, 30, 100000}) {
+            std::vector<uint32_t> hits;
+            grid.query_radius(center, range, hits);
+            std::sort(hits.begin(), hits.end());
+            EXPECT_EQ(hits, brute_radius(block, center, range));
+        }
+    }
+}
+
+TEST(SpatialTest, QuadTreeMatchesBruteForce) {
+    // Тесное скопление поверх разреженного фона
+    auto block = random_block(2000, -50, 550, 11);
+    auto cluster = random_block(3000, 200, 205, 12);
+    for (size_t i = 0; i < cluster.size(); ++i) {
+        block.push_back({cluster.xs[i], cluster.ys[i]});
+    }
+    QuadTree tree;
+    tree.build(block);
+    EXPECT_EQ(tree.size(), block.size());
+
+    std::mt19937 gen(13);
+    std::uniform_int_distribution<int> coord(-100, 600);
+    for (int q = 0; q < 100; ++q) {
+        Position center = q % 2 ? Position{coord(gen), coord(gen)} : Position{202, 203};
+        int range = q % 7 * 15;
+        std::vector<uint32_t> hits;
+        tree.query_radius(center, range, hits);
+        std::sort(hits.begin(), hits.end());
+        EXPECT_EQ(hits, brute_radius(block, center, range));
+    }
+
+    std::vector<uint32_t> hits;
+    tree.query_rect(100, 150, 210, 204, hits);
+    std::sort(hits.begin(), hits.end());
+    std::vector<uint32_t> expected;
+    for (size_t i = 0; i < block.size(); ++i) {
+        if (block.xs[i] >= 100 && block.xs[i] <= 210 && block.ys[i] >= 150 && block.ys[i] <= 204) {
+            expected.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    EXPECT_EQ(hits, expected);
+}
+
+TEST(SpatialTest, QuadTreeIncrementalUpdates) {
+    auto block = random_block(2000, 0, 499, 21);
+    QuadTree tree;
+    tree.build(block);
+
+    std::mt19937 gen(22);
+    std::uniform_int_distribution<int> step(-3, 3);
+    std::vector<bool> present(block.size(), true);
+    for (int tick = 0; tick < 20; ++tick) {
+        for (size_t i = 0; i < block.size(); ++i) {
+            block.xs[i] += step(gen);
+            block.ys[i] += step(gen);
+            tree.update(static_cast<uint32_t>(i), {block.xs[i], block.ys[i]});
+        }
+    }
+    // Точка далеко за корнем растит дерево
+    block.xs[0] = -100000;
+    block.ys[0] = 250000;
+    tree.update(0, {block.xs[0], block.ys[0]});
+
+    for (size_t i = 1; i < block.size(); i += 3) {
+        EXPECT_TRUE(tree.erase(static_cast<uint32_t>(i)));
+        present[i] = false;
+    }
+    EXPECT_FALSE(tree.erase(1));
+    tree.insert(5000, {250, 250});
+
+    size_t expected_size = std::count(present.begin(), present.end(), true) + 1;
+    EXPECT_EQ(tree.size(), expected_size);
+    for (size_t i = 0; i < block.size(); ++i) {
+        if (!present[i]) continue;
+        Position pos = tree.position(static_cast<uint32_t>(i));
+        EXPECT_EQ(pos.x, block.xs[i]);
+        EXPECT_EQ(pos.y, block.ys[i]);
+    }
+    for (Position center : {Position{250, 250}, Position{0, 0}, Position{-100000, 250000}}) {
+        std::vector<uint32_t> hits;
+        tree.query_radius(center, 40, hits);
+        std::sort(hits.begin(), hits.end());
+
+        std::vector<uint32_t> expected;
+        for (uint32_t i : brute_radius(block, center, 40)) {
+            if (present[i]) expected.push_back(i);
+        }
+        if (center.distance_to({250, 250}) <= 40) expected.push_back(5000);
+        EXPECT_EQ(hits, expected);
+    }
+
+    // Почти пустое дерево схлопывается обратно
+    size_t leaves_before = tree.leaf_count();
+    for (size_t i = 0; i < block.size(); ++i) {
+        tree.erase(static_cast<uint32_t>(i));
+    }
+    EXPECT_EQ(tree.size(), 1u);
+    EXPECT_LT(tree.leaf_count(), leaves_before);
+    EXPECT_EQ(tree.leaf_count(), 1u);
+}
+
+TEST(SpatialTest, ShardedCollisionsWithQuadTree) {
+    std::mt19937 gen(31);
+    std::uniform_int_distribution<int> coord(100, 140);
+    std::uniform_int_distribution<int> type(0, static_cast<int>(NPC_TYPE_COUNT) - 1);
+    std::vector<std::shared_ptr<BaseNpc>> npcs;
+    for (int i = 0; i < 1500; ++i) {
+        npcs.push_back(std::make_shared<BaseNpc>(static_cast<NpcType>(type(gen)), "Npc", coord(gen), coord(gen)));
+    }
+    CombatView view;
+    view.assign(npcs.begin(), npcs.end());
+
+    Battle battle;
+    WorldShards shards(64);
+    shards.assign(view);
+    std::vector<CombatPair> by_grid;
+    std::vector<CombatPair> by_tree;
+    shards.find_collisions(battle, view, by_grid, 4, SpatialIndexKind::GRID);
+    shards.find_collisions(battle, view, by_tree, 4, SpatialIndexKind::QUADTREE);
+
+    ASSERT_EQ(by_tree.size(), by_grid.size());
+    for (size_t i = 0; i < by_grid.size(); ++i) {
+        EXPECT_EQ(by_tree[i].attacker, by_grid[i].attacker);
+        EXPECT_EQ(by_tree[i].defender, by_grid[i].defender);
+    }
+}
+
+TEST(SpatialTest, QuadTreeNearestMatchesBruteForce) {
+    auto block = random_block(3000, 0, 499, 41);
+    auto cluster = random_block(2000, 300, 303, 42);
+    for (size_t i = 0; i < cluster.size(); ++i) {
+        block.push_back({cluster.xs[i], cluster.ys[i]});
+    }
+    QuadTree tree;
+    tree.build(block);
+
+    std::mt19937 gen(43);
+    std::uniform_int_distribution<int> coord(-50, 550);
+    std::vector<Neighbour> found;
+    for (int q = 0; q < 50; ++q) {
+        Position center = q % 3 ? Position{coord(gen), coord(gen)} : Position{301, 302};
+        size_t k = static_cast<size_t>(q % 5) * 4 + 1;
+
+        std::vector<Neighbour> expected;
+        for (size_t i = 0; i < block.size(); ++i) {
+            int64_t dx = block.xs[i] - center.x;
+            int64_t dy = block.ys[i] - center.y;
+            expected.push_back({dx * dx + dy * dy, static_cast<uint32_t>(i)});
+        }
+        std::sort(expected.begin(), expected.end());
+        expected.resize(k);
+
+        tree.nearest(center, k, found);
+        ASSERT_EQ(found.size(), k);
+        for (size_t i = 0; i < k; ++i) {
+            EXPECT_EQ(found[i].id, expected[i].id);
+            EXPECT_EQ(found[i].distance_sq, expected[i].distance_sq);
+        }
+    }
+
+    tree.nearest({0, 0}, 5, found, 0);
+    EXPECT_TRUE(found.size() <= 1);
+}
+
+TEST(SpatialTest, TypedIndexFiltersByType) {
+    TypedIndex index;
+    index.update(0, NpcType::FROG, {10, 10});
+    index.update(1, NpcType::BULL, {11, 10});
+    index.update(2, NpcType::FROG, {20, 10});
+    index.update(3, NpcType::DRAGON, {0, 0});
+
+    std::vector<Neighbour> found;
+    index.nearest({12, 10}, type_mask(NpcType::FROG), 5, found);
+    ASSERT_EQ(found.size(), 2u);
+    EXPECT_EQ(found[0].id, 0u);
+    EXPECT_EQ(found[1].id, 2u);
+
+    index.nearest({12, 10}, type_mask(NpcType::FROG) | type_mask(NpcType::BULL), 1, found);
+    ASSERT_EQ(found.size(), 1u);
+    EXPECT_EQ(found[0].id, 1u);
+
+    // Слот, занятый NPC другого вида, переезжает в его дерево
+    index.update(1, NpcType::FROG, {12, 10});
+    index.nearest({12, 10}, type_mask(NpcType::BULL), 1, found);
+    EXPECT_TRUE(found.empty());
+    EXPECT_EQ(index.size(), 4u);
+    EXPECT_EQ(index.position(1).x, 12);
+
+    std::vector<uint32_t> hits;
+    index.query_radius({10, 10}, 3, type_mask(NpcType::FROG), hits);
+    std::sort(hits.begin(), hits.end());
+    EXPECT_EQ(hits, (std::vector<uint32_t>{0, 1}));
+
+    EXPECT_TRUE(index.erase(0));
+    EXPECT_FALSE(index.contains(0));
+    EXPECT_EQ(index.size(), 3u);
+}
+
+TEST(SpatialTest, MortonOrderGroupsNeighbours) {
+    EXPECT_EQ(morton_code(0, 0), 0u);
+    EXPECT_EQ(morton_code(1, 0), 1u);
+    EXPECT_EQ(morton_code(0, 1), 2u);
+    EXPECT_EQ(morton_code(3, 3), 15u);
+
+    auto block = random_block(5000, -300, 300, 51);
+    EXPECT_GT(morton_disorder(block, 16), 0.3);
+
+    auto order = morton_order(block);
+    PositionBlock sorted;
+    for (uint32_t i : order) {
+        sorted.push_back({block.xs[i], block.ys[i]});
+    }
+    EXPECT_EQ(morton_disorder(sorted, 16), 0.0);
+
+    std::vector<uint32_t> check = order;
+    std::sort(check.begin(), check.end());
+    for (size_t i = 0; i < check.size(); ++i) {
+        EXPECT_EQ(check[i], i);
+    }
+}